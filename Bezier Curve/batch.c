@@ -0,0 +1,228 @@
+/*
+ * File:   batch.c
+ * Author: dibyendu
+ *
+ * Headless front end: reads control point sets from a file and writes the
+ * flattened curves as polylines, SVG or PPM frames, without ever opening a
+ * display. Curves are streamed one at a time, so memory stays bounded by
+ * the largest single curve however long the input is.
+ *
+ * Text input has one curve per line as whitespace separated x y pairs;
+ * blank lines and lines starting with '#' are skipped. Binary input starts
+ * with the four bytes "BEZ1" followed by records of a native int32 point
+ * count and that many native double x, y pairs. Curves of more than
+ * MAX_CURVE_POINTS points are malformed in either form.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include "curve.h"
+#include "raster.h"
+
+typedef enum {
+    polyFormat, svgFormat, ppmFormat
+} outputFormat;
+
+const unsigned int curveColour = 0x00FF00,
+                   backgroundColour = 0xFFFFFF;
+
+double
+now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Liang-Barsky: cuts the segment down to the frame, false if none of it is
+ * inside or an end is not finite. Whatever is left rounds to pixels that
+ * rasterLine can walk without overflowing.
+ */
+bool
+clipSegment(double *x0, double *y0, double *x1, double *y1, const raster *frame) {
+    double dx = *x1 - *x0, dy = *y1 - *y0, p[4], q[4], t0 = 0, t1 = 1, t;
+    int k;
+
+    if (!isfinite(dx) || !isfinite(dy))
+        return false;
+    p[0] = -dx, q[0] = *x0;
+    p[1] = dx, q[1] = frame->width - 1 - *x0;
+    p[2] = -dy, q[2] = *y0;
+    p[3] = dy, q[3] = frame->height - 1 - *y0;
+    for (k = 0; k < 4; k++) {
+        if (p[k] == 0) {
+            if (q[k] < 0)
+                return false;
+            continue;
+        }
+        t = q[k] / p[k];
+        if (p[k] < 0)
+            t0 = t > t0 ? t : t0;
+        else
+            t1 = t < t1 ? t : t1;
+        if (t0 > t1)
+            return false;
+    }
+    *x1 = *x0 + t1 * dx;
+    *y1 = *y0 + t1 * dy;
+    *x0 += t0 * dx;
+    *y0 += t0 * dy;
+    return true;
+}
+
+void
+writeCurve(FILE *out, outputFormat format, const polyline *pl, raster *frame) {
+    double x0, y0, x1, y1;
+    int i;
+    switch (format) {
+        case polyFormat:
+            for (i = 0; i < pl->count; i++)
+                fprintf(out, i ? " %.3f %.3f" : "%.3f %.3f", pl->v[i].x, pl->v[i].y);
+            fputc('\n', out);
+            break;
+        case svgFormat:
+            fputs("<polyline fill=\"none\" stroke=\"#00FF00\" points=\"", out);
+            for (i = 0; i < pl->count; i++)
+                fprintf(out, i ? " %.2f,%.2f" : "%.2f,%.2f", pl->v[i].x, pl->v[i].y);
+            fputs("\"/>\n", out);
+            break;
+        case ppmFormat:
+            rasterClear(frame, backgroundColour);
+            for (i = 0; i + 1 < pl->count; i++) {
+                x0 = pl->v[i].x;
+                y0 = pl->v[i].y;
+                x1 = pl->v[i + 1].x;
+                y1 = pl->v[i + 1].y;
+                if (clipSegment(&x0, &y0, &x1, &y1, frame))
+                    rasterLine(frame, lround(x0), lround(y0), lround(x1), lround(y1), curveColour);
+            }
+            rasterWritePPM(frame, out);
+            break;
+    }
+}
+
+void
+usage(const char *name) {
+    fprintf(stderr, "usage: %s [-format poly|svg|ppm] [-mode bezier|bspline|composite] [-tolerance <pixels>]\n"
+            "       [-size <width>x<height>] [-binary] [-timing] [-o <output>] [<input>]\n", name);
+    exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char **argv) {
+    curveReader reader = {stdin, false, NULL, 0, NULL, 0};
+    outputFormat format = polyFormat;
+    splineCache spline;
+    curveMode mode = bezierMode;
+    polyline pl;
+    FILE *out = stdout;
+    raster frame = {0, 0, NULL, 0, 0, 0, 0};
+    double tolerance = 0.2, start, evaluated, written, totalEvaluate = 0, totalStart;
+    int width = 1024, height = 768, i, n, curves = 0;
+    bool timing = false, failed = false;
+    char magic[4];
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-format") && i + 1 < argc) {
+            i++;
+            if (!strcmp(argv[i], "poly"))
+                format = polyFormat;
+            else if (!strcmp(argv[i], "svg"))
+                format = svgFormat;
+            else if (!strcmp(argv[i], "ppm"))
+                format = ppmFormat;
+            else
+                usage(argv[0]);
+        } else if (!strcmp(argv[i], "-mode") && i + 1 < argc) {
+            i++;
+            if (!strcmp(argv[i], "bezier"))
+                mode = bezierMode;
+            else if (!strcmp(argv[i], "bspline"))
+                mode = bsplineMode;
+            else if (!strcmp(argv[i], "composite"))
+                mode = compositeMode;
+            else
+                usage(argv[0]);
+        } else if (!strcmp(argv[i], "-tolerance") && i + 1 < argc && atof(argv[i + 1]) > 0)
+            tolerance = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-size") && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width < 1 || height < 1
+                    || width > RASTER_MAX_SIZE || height > RASTER_MAX_SIZE)
+                usage(argv[0]);
+        } else if (!strcmp(argv[i], "-binary"))
+            reader.binary = true;
+        else if (!strcmp(argv[i], "-timing"))
+            timing = true;
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            if (!(out = fopen(argv[++i], "wb"))) {
+                perror(argv[i]);
+                return (EXIT_FAILURE);
+            }
+        } else if (argv[i][0] != '-' && reader.in == stdin) {
+            if (!(reader.in = fopen(argv[i], "rb"))) {
+                perror(argv[i]);
+                return (EXIT_FAILURE);
+            }
+        } else
+            usage(argv[0]);
+    }
+
+    if (reader.binary && (fread(magic, 1, 4, reader.in) != 4 || memcmp(magic, "BEZ1", 4))) {
+        fprintf(stderr, "%s: input is not a BEZ1 file\n", argv[0]);
+        return (EXIT_FAILURE);
+    }
+    if (format == ppmFormat && rasterInit(&frame, width, height) < 0) {
+        fprintf(stderr, "%s: can not allocate a %dx%d frame\n", argv[0], width, height);
+        return (EXIT_FAILURE);
+    }
+    if (format == svgFormat)
+        fprintf(out, "<?xml version=\"1.0\"?>\n<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"%d\" height=\"%d\">\n",
+                width, height);
+
+    polylineInit(&pl);
+    splineInit(&spline, mode);
+    totalStart = now();
+    while ((n = readCurve(&reader)) > 0) {
+        start = now();
+        splineInvalidate(&spline, -1);
+        if (splinePolyline(&spline, reader.ctrl, n, tolerance, &pl) < 0) {
+            fprintf(stderr, "curve %d: failed\n", ++curves);
+            failed = true;
+            continue;
+        }
+        evaluated = now();
+        writeCurve(out, format, &pl, &frame);
+        written = now();
+        totalEvaluate += evaluated - start;
+        if (timing)
+            fprintf(stderr, "curve %d: %d points, %d vertices, %.1f us evaluate, %.1f us output\n",
+                    curves + 1, n, pl.count, (evaluated - start) * 1e6, (written - evaluated) * 1e6);
+        curves++;
+    }
+    if (n < 0)
+        fprintf(stderr, "%s: malformed curve after curve %d\n", argv[0], curves);
+
+    if (format == svgFormat)
+        fputs("</svg>\n", out);
+    fflush(out);
+    if (timing && curves) {
+        double total = now() - totalStart;
+        fprintf(stderr, "%d curves in %.3f s (%.3f s evaluating), %.0f curves/s\n",
+                curves, total, totalEvaluate, curves / total);
+    }
+
+    splineFree(&spline);
+    polylineFree(&pl);
+    rasterFree(&frame);
+    free(reader.ctrl);
+    free(reader.line);
+    if (out != stdout)
+        fclose(out);
+    return n < 0 || failed ? (EXIT_FAILURE) : (EXIT_SUCCESS);
+}
@@ -0,0 +1,130 @@
+/*
+ * File:   bench.c
+ * Author: dibyendu
+ *
+ * Benchmark of the curve kernels on generated input: for every curve mode
+ * and a sweep of control point counts, flattens a batch of generated control
+ * polygons inside the default window and reports throughput and latency
+ * percentiles per curve. Then fills a scene with a hundred thousand such
+ * curves, shrunk and scattered over a large world, and times viewport
+ * queries and control point picks through its index. The input is the same
+ * from run to run, so the numbers of two builds can be compared directly.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "curve.h"
+#include "scene.h"
+#include "trace.h"
+
+const int sweep[] = {3, 4, 8, 16, 32, 64, 128, 256, 512, 900},
+          noOfSweeps = sizeof (sweep) / sizeof (sweep[0]);
+
+const char *modeLabel[] = {"bezier", "bspline", "composite"};
+
+const int sceneCurves = 100000;
+
+double
+uniform(unsigned int *seed) {
+    return (double) rand_r(seed) / RAND_MAX;
+}
+
+/*
+ * Points spread along a random wavy path across the rectangle, the way
+ * they are clicked in. Uniformly random points would make the degree 900
+ * curve oscillate so wildly that its flattening alone measures nothing
+ * but memory bandwidth.
+ */
+void
+generateCurve(vertex *ctrl, int n, unsigned int *seed) {
+    double f1 = 1 + 2 * uniform(seed), f2 = 1 + 2 * uniform(seed), f3 = 1 + 2 * uniform(seed),
+           p1 = uniform(seed), p2 = uniform(seed), p3 = uniform(seed), u;
+    int j;
+    for (j = 0; j < n; j++) {
+        u = (double) j / (n - 1);
+        (ctrl + j)->x = 112 + 800 * u + 40 * sin(2 * M_PI * (u * f1 + p1));
+        (ctrl + j)->y = 384 + 150 * sin(2 * M_PI * (u * f2 + p2)) + 80 * sin(2 * M_PI * (u * f3 + p3));
+    }
+}
+
+int
+main(int argc, char **argv) {
+    static char names[3][sizeof (sweep) / sizeof (sweep[0])][32];
+    tracer trace;
+    splineCache spline;
+    scene world;
+    const int *found;
+    polyline pl;
+    vertex *ctrl;
+    unsigned int seed = 1;
+    double tolerance = 0.2, scale = 1, start, first, x, y;
+    int mode, k, i, j, n;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-tolerance") && i + 1 < argc && atof(argv[i + 1]) > 0)
+            tolerance = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-scale") && i + 1 < argc && atof(argv[i + 1]) > 0)
+            scale = atof(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [-tolerance <pixels>] [-scale <factor>]\n", argv[0]);
+            return (EXIT_FAILURE);
+        }
+    }
+
+    traceInit(&trace);
+    polylineInit(&pl);
+    ctrl = (vertex *) malloc(sizeof (vertex) * sweep[noOfSweeps - 1]);
+    for (mode = bezierMode; mode <= compositeMode; mode++) {
+        splineInit(&spline, mode);
+        for (k = 0; k < noOfSweeps; k++) {
+            n = sweep[k];
+            sprintf(names[mode][k], "%s %d", modeLabel[mode], n);
+            /* at least ten curves, then more for as long as the time allows */
+            for (i = 0, first = traceNow(); i < 10 || (i < 10000 && traceNow() - first < 0.2 * scale); i++) {
+                generateCurve(ctrl, n, &seed);
+                start = traceNow();
+                splineInvalidate(&spline, -1);
+                splinePolyline(&spline, ctrl, n, tolerance, &pl);
+                traceRecord(&trace, names[mode][k], 0, start, traceNow(), -1);
+            }
+        }
+        splineFree(&spline);
+    }
+
+    /* curves a tenth of the window in size on a world a thousand windows large */
+    sceneInit(&world, bezierMode, 64);
+    for (i = 0; i < sceneCurves; i++) {
+        generateCurve(ctrl, 8, &seed);
+        x = 32000 * uniform(&seed);
+        y = 24000 * uniform(&seed);
+        for (j = 0; j < 8; j++) {
+            ctrl[j].x = x + ctrl[j].x / 10;
+            ctrl[j].y = y + ctrl[j].y / 10;
+        }
+        sceneAdd(&world, ctrl, 8);
+    }
+    sceneReindex(&world);
+    for (i = 0, first = traceNow(); i < 10 || (i < 100000 && traceNow() - first < 0.2 * scale); i++) {
+        x = 31000 * uniform(&seed);
+        y = 23000 * uniform(&seed);
+        start = traceNow();
+        sceneQuery(&world, x, y, x + 1024, y + 768, &found);
+        traceRecord(&trace, "scene query", 0, start, traceNow(), -1);
+    }
+    for (i = 0, first = traceNow(); i < 10 || (i < 100000 && traceNow() - first < 0.2 * scale); i++) {
+        x = 32000 * uniform(&seed);
+        y = 24000 * uniform(&seed);
+        start = traceNow();
+        scenePick(&world, x, y, 8, &j);
+        traceRecord(&trace, "scene pick", 0, start, traceNow(), -1);
+    }
+    sceneFree(&world);
+    traceSummary(&trace, stdout);
+
+    free(ctrl);
+    polylineFree(&pl);
+    traceFree(&trace);
+    return (EXIT_SUCCESS);
+}
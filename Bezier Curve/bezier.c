@@ -11,53 +11,63 @@
 #include <string.h>
 #include <math.h>
 #include <time.h>
+#include <unistd.h>
 #include <X11/Xlib.h>
 #include <X11/keysym.h>
+#include "curve.h"
+#include "scene.h"
+#include "xcache.h"
+#include "xframe.h"
+#include "trace.h"
 
-typedef struct {
-    unsigned long long x, y;
-} point;
+/*
+ * Sizes for a 96 DPI screen; layoutResize scales them by the screen's
+ * density and fits the rectangle to the window, whatever size it is.
+ */
+int windowWidth = 1024,
+    windowHeight = 768,
+    rectWidth = 800,
+    rectHeight = 500,
+    pointRadius = 4,
+    labelPadding = 32,
+    lineWidth = 2;
+double displayScale = 1;
 
-const int windowWidth = 1024,
-          windowHeight = 768,
-          rectWidth = 800,
-          rectHeight = 500,
-          pointRadius = 4;
+double tolerance = 0.2;
+int threads = 0,
+    progressRate = 30;
 
 const char *text = "#000000",
            *rect = "#00BBFF",
            *pointColour = "#FF0000",
            *curve = "#00FF00",
-           *message = "Bezier Curve";
+           *message = "Bezier Curve",
+           *modeName[] = {"Bezier Curve Window", "Bezier Curve Window - uniform cubic B-spline",
+                          "Bezier Curve Window - composite cubic bezier"};
 
-int *
-drawText(Display *d, Window *w, GC *gc, int textX, int textY, const char *str) {
-    XFontStruct *font;
-    char **list;
-    int *textWidth_and_Height, returnNo;
+xcache *resources;
 
-    textWidth_and_Height = (int *) calloc(2, sizeof (int));
+/* NULL unless -trace or -stats asked for instrumentation. */
+tracer *trace;
 
-    list = XListFonts(d, "-*-*-bold-r-normal--*-*-100-100-c-*-*", 200, &returnNo);
-    if (returnNo) {
-        srand(time(NULL));
-        static int fontIndex = -1;
-        fontIndex = fontIndex == -1 ? rand() % returnNo : fontIndex;
-        font = XLoadQueryFont(d, *(list + fontIndex));
-        XFreeFontNames(list);
-    }
+int *
+drawText(Display *d, Window *w, GC *gc, int textX, int textY, const char *str) {
+    XFontStruct *font = xcacheFont(resources);
+    int *textWidth_and_Height;
 
     if (!font)
         return NULL;
 
+    textWidth_and_Height = (int *) calloc(2, sizeof (int));
     XSetFont(d, *gc, font->fid);
 
-    textWidth_and_Height[0] = XTextWidth(font, str, strlen(str));
-    textWidth_and_Height[1] = font->ascent + font->descent;
+    textWidth_and_Height[0] = xcacheTextWidth(resources, str);
+    textWidth_and_Height[1] = xcacheTextHeight(resources);
     if (textX == 0 && textY == 0) {
         textX = (windowWidth - textWidth_and_Height[0]) / 2;
         textY = ((windowHeight - rectHeight) / 2 - textWidth_and_Height[1]) / 2 + textWidth_and_Height[1] / 2;
         free(textWidth_and_Height);
+        textWidth_and_Height = NULL;
     } else
         textY -= textWidth_and_Height[1];
 
@@ -65,15 +75,26 @@ drawText(Display *d, Window *w, GC *gc, int textX, int textY, const char *str) {
     return textWidth_and_Height;
 }
 
+/* drawText for text that is not centred; returns just the width, 0 without a font. */
+int
+drawTextWidth(Display *d, Window *w, GC *gc, int textX, int textY, const char *str) {
+    int *size = drawText(d, w, gc, textX, textY, str), width = size ? size[0] : 0;
+    free(size);
+    return width;
+}
+
+/* Margins grow with the density, but never take more than half the window. */
 void
-createGC(Display *d, Window *w, int screen, int lineWidth, GC *gc, const char *colour, XColor *xcolor) {
-    *gc = XCreateGC(d, *w, 0, 0);
-    XParseColor(d, DefaultColormap(d, screen), colour, xcolor);
-    XAllocColor(d, DefaultColormap(d, screen), xcolor);
-    XSetForeground(d, *gc, xcolor->pixel);
-    XSetLineAttributes(d, *gc, lineWidth, LineSolid, CapRound, JoinRound);
-    XSetFillStyle(d, *gc, FillSolid);
-    return;
+layoutResize(int width, int height) {
+    windowWidth = width;
+    windowHeight = height;
+    rectWidth = width - 2 * (int) lround(112 * displayScale);
+    rectWidth = rectWidth < width / 2 ? width / 2 : rectWidth;
+    rectHeight = height - 2 * (int) lround(134 * displayScale);
+    rectHeight = rectHeight < height / 2 ? height / 2 : rectHeight;
+    pointRadius = (int) lround(4 * displayScale);
+    labelPadding = (int) lround(32 * displayScale);
+    lineWidth = (int) lround(2 * displayScale);
 }
 
 bool
@@ -84,78 +105,653 @@ checkPointLocation(int x, int y) {
     return true;
 }
 
-long long
-nCr(int n, int r) {
-    if (n < r) return -1;
+/*
+ * XDrawLines in pieces small enough for the server's request size limit,
+ * repeating the joint vertex so the pieces stay connected.
+ */
+void
+drawPolyline(Display *d, Drawable w, GC gc, const vertex *v, int count) {
+    int maxPoints = (XMaxRequestSize(d) - 3) - 1, i, j, n;
+    XPoint *xp;
+
+    if (count < 2)
+        return;
+    n = count < maxPoints ? count : maxPoints;
+    xp = (XPoint *) malloc(sizeof (XPoint) * n);
+    for (i = 0; i < count - 1; i += n - 1) {
+        int pieceCount = count - i < n ? count - i : n;
+        for (j = 0; j < pieceCount; j++) {
+            xp[j].x = lround(v[i + j].x);
+            xp[j].y = lround(v[i + j].y);
+        }
+        XDrawLines(d, w, gc, xp, pieceCount, CoordModeOrigin);
+    }
+    free(xp);
+}
+
+#define BATCH_SIZE 1024
+
+/*
+ * State of the live editing mode, entered once a curve has been drawn or a
+ * set of curves loaded. The scene is in world coordinates and the view
+ * shows it with (x, y) at the window's origin, scale pixels to the unit.
+ * The canvas mirrors the window; every frame repaints only the damaged
+ * part of it, drawing just the curves the scene's index finds there, and
+ * copies that across. With software rendering frame takes the place of the
+ * canvas and the pixels are those of the GCs' colours. The selected curve
+ * shows its control polygon and numbered points, the others small dots.
+ */
+typedef struct {
+    Display *d;
+    Window w;
+    Pixmap canvas;
+    xframe *frame;
+    unsigned int textPixel, pointPixel, curvePixel;
+    GC textGc, pointGc, curveGc, invGc;
+    scene *scene;
+    int selected;
+    double x, y, scale;
+    XRectangle inside;
+    XSegment segments[BATCH_SIZE];
+    XRectangle dots[BATCH_SIZE];
+    int noOfSegments, noOfDots;
+} liveView;
+
+XRectangle
+rectUnion(XRectangle a, XRectangle b) {
+    XRectangle r;
+    if (!a.width || !a.height)
+        return b;
+    if (!b.width || !b.height)
+        return a;
+    r.x = a.x < b.x ? a.x : b.x;
+    r.y = a.y < b.y ? a.y : b.y;
+    r.width = (a.x + a.width > b.x + b.width ? a.x + a.width : b.x + b.width) - r.x;
+    r.height = (a.y + a.height > b.y + b.height ? a.y + a.height : b.y + b.height) - r.y;
+    return r;
+}
+
+XRectangle
+rectIntersection(XRectangle a, XRectangle b) {
+    XRectangle r = {0, 0, 0, 0};
+    int x1 = a.x > b.x ? a.x : b.x, y1 = a.y > b.y ? a.y : b.y,
+        x2 = a.x + a.width < b.x + b.width ? a.x + a.width : b.x + b.width,
+        y2 = a.y + a.height < b.y + b.height ? a.y + a.height : b.y + b.height;
+    if (x2 > x1 && y2 > y1) {
+        r.x = x1;
+        r.y = y1;
+        r.width = x2 - x1;
+        r.height = y2 - y1;
+    }
+    return r;
+}
+
+double
+windowX(const liveView *v, double x) {
+    return (x - v->x) * v->scale;
+}
+
+double
+windowY(const liveView *v, double y) {
+    return (y - v->y) * v->scale;
+}
+
+double
+worldX(const liveView *v, double x) {
+    return v->x + x / v->scale;
+}
+
+double
+worldY(const liveView *v, double y) {
+    return v->y + y / v->scale;
+}
+
+/* Part of the window covered by curve i, its points and their labels. */
+XRectangle
+curveRectangle(const liveView *v, int i) {
+    XRectangle r = {0, 0, 0, 0};
+    const sceneCurve *c;
+    double x0, y0, x1, y1;
+
+    if (i < 0)
+        return r;
+    c = v->scene->curves + i;
+    /* cut to the view first, which also keeps it within the range of a short */
+    x0 = fmax(floor(windowX(v, c->minX)) - pointRadius - 1, v->inside.x);
+    y0 = fmax(floor(windowY(v, c->minY)) - labelPadding, v->inside.y);
+    x1 = fmin(ceil(windowX(v, c->maxX)) + labelPadding, v->inside.x + v->inside.width);
+    y1 = fmin(ceil(windowY(v, c->maxY)) + pointRadius + 1, v->inside.y + v->inside.height);
+    if (x1 > x0 && y1 > y0) {
+        r.x = x0;
+        r.y = y0;
+        r.width = x1 - x0;
+        r.height = y1 - y0;
+    }
+    return r;
+}
+
+/*
+ * The segment a -> b in window coordinates, false if it lies wholly to one
+ * side of the damage. What is left is cut down to a margin around the view
+ * so that it fits the coordinates of X requests however far in the view
+ * is zoomed; the clip rectangles trim it to the damage exactly.
+ */
+bool
+windowSegment(const liveView *v, const vertex *a, const vertex *b, XRectangle damage,
+        double *x0, double *y0, double *x1, double *y1) {
+    double left = v->inside.x - 4096, top = v->inside.y - 4096,
+           right = v->inside.x + v->inside.width + 4096, bottom = v->inside.y + v->inside.height + 4096,
+           dx, dy, p[4], q[4], t0 = 0, t1 = 1, t;
+    int k;
+
+    *x0 = windowX(v, a->x);
+    *y0 = windowY(v, a->y);
+    *x1 = windowX(v, b->x);
+    *y1 = windowY(v, b->y);
+    if ((*x0 < damage.x - 1 && *x1 < damage.x - 1) || (*x0 > damage.x + damage.width && *x1 > damage.x + damage.width) ||
+            (*y0 < damage.y - 1 && *y1 < damage.y - 1) || (*y0 > damage.y + damage.height && *y1 > damage.y + damage.height))
+        return false;
+    /* Liang-Barsky against the margin */
+    dx = *x1 - *x0;
+    dy = *y1 - *y0;
+    p[0] = -dx, q[0] = *x0 - left;
+    p[1] = dx, q[1] = right - *x0;
+    p[2] = -dy, q[2] = *y0 - top;
+    p[3] = dy, q[3] = bottom - *y0;
+    for (k = 0; k < 4; k++) {
+        if (p[k] == 0) {
+            if (q[k] < 0)
+                return false;
+            continue;
+        }
+        t = q[k] / p[k];
+        if (p[k] < 0)
+            t0 = t > t0 ? t : t0;
+        else
+            t1 = t < t1 ? t : t1;
+        if (t0 > t1)
+            return false;
+    }
+    *x1 = *x0 + t1 * dx;
+    *y1 = *y0 + t1 * dy;
+    *x0 += t0 * dx;
+    *y0 += t0 * dy;
+    return true;
+}
+
+/* Whether a control point at (x, y) in the window draws anything inside the damage. */
+bool
+nearDamage(double x, double y, XRectangle damage, int margin) {
+    return x >= damage.x - margin && x <= damage.x + damage.width + margin &&
+            y >= damage.y - margin && y <= damage.y + damage.height + margin;
+}
+
+/* Dashes of four pixels on, four off, like the default of the text GC. */
+void
+dashedLine(raster *r, double x0, double y0, double x1, double y1, unsigned int colour) {
+    double length = hypot(x1 - x0, y1 - y0), t, u;
+    for (t = 0; t < length; t += 8) {
+        u = t + 3 < length ? t + 3 : length;
+        rasterLine(r, lround(x0 + (x1 - x0) * t / length), lround(y0 + (y1 - y0) * t / length),
+                lround(x0 + (x1 - x0) * u / length), lround(y0 + (y1 - y0) * u / length), colour);
+    }
+}
+
+/* The scene of renderLive drawn into the frame, clipped to damage. */
+void
+renderLiveRaster(liveView *v, const int *visible, int count, XRectangle damage) {
+    raster *r = &v->frame->r;
+    const sceneCurve *c;
+    const sceneTier *t;
+    double x0, y0, x1, y1;
+    bool selected = false;
+    char buffer[12];
     int i, j;
-    long long productN = 1, productR = 1;
-    for (i = n, j = 1; j <= r; i--, j++) {
-        productN *= i;
-        productR *= j;
+
+    rasterClip(r, damage.x, damage.y, damage.width, damage.height);
+    rasterFillRectangle(r, damage.x, damage.y, damage.width, damage.height, 0xFFFFFF);
+    for (i = 0; i < count; i++) {
+        t = sceneShown(v->scene, visible[i]);
+        selected |= visible[i] == v->selected;
+        for (j = 0; t && visible[i] != v->selected && j < t->count - 1; j++)
+            if (windowSegment(v, t->v + j, t->v + j + 1, damage, &x0, &y0, &x1, &y1))
+                rasterLine(r, lround(x0), lround(y0), lround(x1), lround(y1), v->curvePixel);
+    }
+    for (i = 0; i < count; i++) {
+        c = v->scene->curves + visible[i];
+        for (j = 0; visible[i] != v->selected && j < c->n; j++)
+            if (nearDamage(windowX(v, c->ctrl[j].x), windowY(v, c->ctrl[j].y), damage, pointRadius / 2))
+                rasterFillRectangle(r, lround(windowX(v, c->ctrl[j].x)) - pointRadius / 2,
+                        lround(windowY(v, c->ctrl[j].y)) - pointRadius / 2, pointRadius, pointRadius, v->pointPixel);
     }
-    return productN / productR;
+    if (selected) {
+        c = v->scene->curves + v->selected;
+        t = sceneShown(v->scene, v->selected);
+        for (j = 0; j < c->n - 1; j++)
+            if (windowSegment(v, c->ctrl + j, c->ctrl + j + 1, damage, &x0, &y0, &x1, &y1))
+                dashedLine(r, x0, y0, x1, y1, v->textPixel);
+        for (j = 0; t && j < t->count - 1; j++)
+            if (windowSegment(v, t->v + j, t->v + j + 1, damage, &x0, &y0, &x1, &y1))
+                rasterLine(r, lround(x0), lround(y0), lround(x1), lround(y1), v->curvePixel);
+        for (j = 0; j < c->n; j++) {
+            x0 = windowX(v, c->ctrl[j].x);
+            y0 = windowY(v, c->ctrl[j].y);
+            if (!nearDamage(x0, y0, damage, labelPadding))
+                continue;
+            rasterFillCircle(r, x0, y0, pointRadius, v->pointPixel);
+            sprintf(buffer, "%d", j + 1);
+            rasterText(r, x0, y0 - RASTER_FONT_HEIGHT, buffer, v->textPixel);
+        }
+    }
+    rasterClip(r, 0, 0, r->width, r->height);
+    xframePut(v->frame, v->w, v->invGc, damage.x, damage.y, damage.width, damage.height);
+}
+
+void
+flushSegments(liveView *v) {
+    if (v->noOfSegments)
+        XDrawSegments(v->d, v->canvas, v->curveGc, v->segments, v->noOfSegments);
+    v->noOfSegments = 0;
 }
 
-int main() {
+void
+flushDots(liveView *v) {
+    if (v->noOfDots)
+        XFillRectangles(v->d, v->canvas, v->pointGc, v->dots, v->noOfDots);
+    v->noOfDots = 0;
+}
+
+/* Queues the shown polyline of curve i, in as few requests as the batch allows. */
+void
+queuePolyline(liveView *v, int i, XRectangle damage) {
+    const sceneTier *t = sceneShown(v->scene, i);
+    double x0, y0, x1, y1;
+    int j;
+    for (j = 0; t && j < t->count - 1; j++)
+        if (windowSegment(v, t->v + j, t->v + j + 1, damage, &x0, &y0, &x1, &y1)) {
+            if (v->noOfSegments == BATCH_SIZE)
+                flushSegments(v);
+            v->segments[v->noOfSegments].x1 = lround(x0);
+            v->segments[v->noOfSegments].y1 = lround(y0);
+            v->segments[v->noOfSegments].x2 = lround(x1);
+            v->segments[v->noOfSegments].y2 = lround(y1);
+            v->noOfSegments++;
+        }
+}
+
+/* The same drawn by the server into the canvas. */
+void
+drawLive(liveView *v, const int *visible, int count, XRectangle damage) {
+    GC gcs[3] = {v->textGc, v->pointGc, v->curveGc};
+    const sceneCurve *c;
+    double x0, y0, x1, y1;
+    bool selected = false;
+    char buffer[12];
+    int i, j;
+
+    XFillRectangle(v->d, v->canvas, v->invGc, damage.x, damage.y, damage.width, damage.height);
+    for (i = 0; i < 3; i++)
+        XSetClipRectangles(v->d, gcs[i], 0, 0, &damage, 1, Unsorted);
+    for (i = 0; i < count; i++) {
+        selected |= visible[i] == v->selected;
+        if (visible[i] != v->selected)
+            queuePolyline(v, visible[i], damage);
+    }
+    flushSegments(v);
+    for (i = 0; i < count; i++) {
+        c = v->scene->curves + visible[i];
+        for (j = 0; visible[i] != v->selected && j < c->n; j++)
+            if (nearDamage(windowX(v, c->ctrl[j].x), windowY(v, c->ctrl[j].y), damage, pointRadius / 2)) {
+                if (v->noOfDots == BATCH_SIZE)
+                    flushDots(v);
+                v->dots[v->noOfDots].x = lround(windowX(v, c->ctrl[j].x)) - pointRadius / 2;
+                v->dots[v->noOfDots].y = lround(windowY(v, c->ctrl[j].y)) - pointRadius / 2;
+                v->dots[v->noOfDots].width = v->dots[v->noOfDots].height = pointRadius;
+                v->noOfDots++;
+            }
+    }
+    flushDots(v);
+    if (selected) {
+        c = v->scene->curves + v->selected;
+        for (j = 0; j < c->n - 1; j++)
+            if (windowSegment(v, c->ctrl + j, c->ctrl + j + 1, damage, &x0, &y0, &x1, &y1))
+                XDrawLine(v->d, v->canvas, v->textGc, lround(x0), lround(y0), lround(x1), lround(y1));
+        queuePolyline(v, v->selected, damage);
+        flushSegments(v);
+        for (j = 0; j < c->n; j++) {
+            x0 = windowX(v, c->ctrl[j].x);
+            y0 = windowY(v, c->ctrl[j].y);
+            if (!nearDamage(x0, y0, damage, labelPadding))
+                continue;
+            XFillArc(v->d, v->canvas, v->pointGc, lround(x0) - pointRadius, lround(y0) - pointRadius,
+                    pointRadius * 2, pointRadius * 2, 0, 360 * 64);
+            sprintf(buffer, "%d", j + 1);
+            free(drawText(v->d, &v->canvas, &v->textGc, lround(x0), lround(y0), buffer));
+        }
+    }
+    for (i = 0; i < 3; i++)
+        XSetClipMask(v->d, gcs[i], None);
+    XCopyArea(v->d, v->canvas, v->w, v->invGc, damage.x, damage.y, damage.width, damage.height, damage.x, damage.y);
+}
+
+/*
+ * Repaints damage: the index finds the curves there, each one shows its
+ * polyline at the level of detail of the current zoom, flattened only if
+ * it was not one of the last few it was shown at, and they are drawn.
+ */
+void
+renderLive(liveView *v, XRectangle damage) {
+    unsigned long requests = NextRequest(v->d);
+    double start = traceNow(), evaluated, margin = labelPadding / v->scale;
+    const int *visible;
+    int count, i;
+
+    damage = rectIntersection(damage, v->inside);
+    if (!damage.width)
+        return;
+    count = sceneQuery(v->scene, worldX(v, damage.x) - margin, worldY(v, damage.y) - margin,
+            worldX(v, damage.x + damage.width) + margin, worldY(v, damage.y + damage.height) + margin, &visible);
+    for (i = 0; i < count; i++)
+        scenePolyline(v->scene, visible[i], tolerance / v->scale);
+    evaluated = traceNow();
+    traceRecord(trace, "evaluate", 0, start, evaluated, -1);
+
+    if (v->frame)
+        renderLiveRaster(v, visible, count, damage);
+    else
+        drawLive(v, visible, count, damage);
+    traceRecord(trace, "draw", 0, evaluated, traceNow(), -1);
+    traceRecord(trace, "frame", 0, start, traceNow(), NextRequest(v->d) - requests);
+}
+
+/* Enters live editing; from then on the window only ever shows the canvas, or the frame. */
+void
+startLive(liveView *v, GC rectGc) {
+    int rectX = (windowWidth - rectWidth) / 2, rectY = (windowHeight - rectHeight) / 2;
+
+    if (v->frame) {
+        rasterClear(&v->frame->r, 0xFFFFFF);
+        rasterText(&v->frame->r, (windowWidth - rasterTextWidth(message)) / 2,
+                ((windowHeight - rectHeight) / 2 - RASTER_FONT_HEIGHT) / 2 + RASTER_FONT_HEIGHT / 2,
+                message, v->textPixel);
+        rasterRectangle(&v->frame->r, rectX, rectY, rectWidth, rectHeight, lineWidth, rasterColour(rect));
+    } else {
+        XFillRectangle(v->d, v->canvas, v->invGc, 0, 0, windowWidth, windowHeight);
+        drawText(v->d, &v->canvas, &v->textGc, 0, 0, message);
+        XDrawRectangle(v->d, v->canvas, rectGc, rectX, rectY, rectWidth, rectHeight);
+    }
+    renderLive(v, v->inside);
+    if (v->frame)
+        xframePut(v->frame, v->w, v->invGc, 0, 0, windowWidth, windowHeight);
+}
+
+/* Makes curve i (or none if negative) the one whose points are shown and extended by clicks. */
+void
+selectCurve(liveView *v, int i) {
+    XRectangle damage = rectUnion(curveRectangle(v, v->selected), curveRectangle(v, i));
+    v->selected = i;
+    renderLive(v, damage);
+}
+
+/* The part of the window inside the rectangle, where live mode draws. */
+XRectangle
+insideRectangle(void) {
+    XRectangle r;
+    r.x = (windowWidth - rectWidth) / 2 + lineWidth;
+    r.y = (windowHeight - rectHeight) / 2 + lineWidth;
+    r.width = rectWidth - 2 * lineWidth + 1;
+    r.height = rectHeight - 2 * lineWidth + 1;
+    return r;
+}
+
+/* Zooms by factor keeping the world point under (x, y) where it is. */
+void
+zoomView(liveView *v, double factor, int x, int y) {
+    double wx = worldX(v, x), wy = worldY(v, y);
+    v->scale = fmin(fmax(v->scale * factor, 1e-6), 1e6);
+    v->x = wx - x / v->scale;
+    v->y = wy - y / v->scale;
+    renderLive(v, v->inside);
+}
+
+/* Shows every curve, or the world as the window has it if there are none. */
+void
+fitView(liveView *v) {
+    double minX, minY, maxX, maxY;
+
+    v->x = v->y = 0;
+    v->scale = 1;
+    if (sceneBounds(v->scene, &minX, &minY, &maxX, &maxY)) {
+        v->scale = 0.9 * fmin(v->inside.width / fmax(maxX - minX, 1e-9), v->inside.height / fmax(maxY - minY, 1e-9));
+        v->scale = fmin(fmax(v->scale, 1e-6), 1e6);
+        v->x = (minX + maxX) / 2 - (v->inside.x + v->inside.width / 2.0) / v->scale;
+        v->y = (minY + maxY) / 2 - (v->inside.y + v->inside.height / 2.0) / v->scale;
+    }
+}
+
+int main(int argc, char **argv) {
     Display *d;
     Window w, subw;
     GC rectGc, textGc, pointGc, curveGc, invGc;
-    XColor rectColor, pointColor, curveColor, textColor;
     XEvent e;
     KeySym key;
 
-    point *p = NULL;
+    vertex *p = NULL, v;
+
+    int rectX, rectY, s, noOfPoints = 0;
+    int exposeCount = 0, i, n, dragCurve = -1, dragIndex = -1, panX = 0, panY = 0;
+    char buffer[12], magic[4];
+    polyline curvePoints;
+    bool live = false, software = false, stats = false, panning = false;
+    liveView view;
+    xframe frame;
+    tracer spans;
+    const char *traceFile = NULL;
+    double start;
+    scene curves;
+    curveReader reader = {NULL, false, NULL, 0, NULL, 0};
+    XRectangle damage;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-tolerance") && i + 1 < argc && atof(argv[i + 1]) > 0)
+            tolerance = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-threads") && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-software"))
+            software = true;
+        else if (!strcmp(argv[i], "-trace") && i + 1 < argc)
+            traceFile = argv[++i];
+        else if (!strcmp(argv[i], "-stats"))
+            stats = true;
+        else if (!strcmp(argv[i], "-binary"))
+            reader.binary = true;
+        else if (argv[i][0] != '-' && !reader.in) {
+            if (!(reader.in = fopen(argv[i], "rb"))) {
+                perror(argv[i]);
+                return (EXIT_FAILURE);
+            }
+        } else {
+            fprintf(stderr, "usage: %s [-tolerance <pixels>] [-threads <count>] [-software] [-trace <file>] [-stats]\n"
+                    "              [-binary] [<curves>]\n", argv[0]);
+            return (EXIT_FAILURE);
+        }
+    }
+    if (!threads)
+        threads = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+    if (traceFile || stats) {
+        traceInit(&spans);
+        trace = &spans;
+    }
+    polylineInit(&curvePoints);
+    sceneInit(&curves, bezierMode, 64);
 
-    int rectX = (windowWidth - rectWidth) / 2, rectY = (windowHeight - rectHeight) / 2, s, noOfPoints = 0;
-    int exposeCount = 0;
-    char buffer[3];
+    /* curves in the format of bezierbatch, browsed from the start */
+    if (reader.in) {
+        if (reader.binary && (fread(magic, 1, 4, reader.in) != 4 || memcmp(magic, "BEZ1", 4))) {
+            fprintf(stderr, "%s: input is not a BEZ1 file\n", argv[0]);
+            return (EXIT_FAILURE);
+        }
+        while ((n = readCurve(&reader)) > 0)
+            if (sceneAdd(&curves, reader.ctrl, n) < 0) {
+                fprintf(stderr, "%s: out of memory after %d curves\n", argv[0], curves.noOfCurves);
+                return (EXIT_FAILURE);
+            }
+        if (n < 0)
+            fprintf(stderr, "%s: malformed curve after curve %d\n", argv[0], curves.noOfCurves);
+        fclose(reader.in);
+        free(reader.ctrl);
+        free(reader.line);
+        sceneReindex(&curves);
+    }
 
     d = XOpenDisplay(NULL);
     s = DefaultScreen(d);
+
+    /* as many screen pixels to a layout pixel as the screen is dense, as long as it fits */
+    displayScale = xcacheScale(d, s);
+    layoutResize(windowWidth * displayScale < DisplayWidth(d, s) ? (int) (windowWidth * displayScale) : DisplayWidth(d, s),
+            windowHeight * displayScale < DisplayHeight(d, s) ? (int) (windowHeight * displayScale) : DisplayHeight(d, s));
+    rectX = (windowWidth - rectWidth) / 2;
+    rectY = (windowHeight - rectHeight) / 2;
     w = XCreateSimpleWindow(d, RootWindow(d, s), 0, 0, windowWidth, windowHeight, 0, 0, WhitePixel(d, s));
 
     XStoreName(d, w, "Bezier Curve Window");
-    XSelectInput(d, w, ExposureMask | KeyPressMask | ButtonPressMask);
+    XSelectInput(d, w, ExposureMask | KeyPressMask | ButtonPressMask | ButtonReleaseMask | Button1MotionMask | Button2MotionMask
+            | StructureNotifyMask);
     XMapWindow(d, w);
     XMoveWindow(d, w, (DisplayWidth(d, s) - windowWidth) / 2, (DisplayHeight(d, s) - windowHeight) / 2);
 
+    resources = xcacheOpen(d, s, w);
+
     textGc = XCreateGC(d, w, 0, 0);
-    XParseColor(d, DefaultColormap(d, s), text, &textColor);
-    XAllocColor(d, DefaultColormap(d, s), &textColor);
-    XSetForeground(d, textGc, textColor.pixel);
+    XSetForeground(d, textGc, xcachePixel(resources, text));
     XSetBackground(d, textGc, WhitePixel(d, s));
-    XSetLineAttributes(d, textGc, 1, LineOnOffDash, CapRound, JoinRound);
+    XSetLineAttributes(d, textGc, lineWidth / 2, LineOnOffDash, CapRound, JoinRound);
 
-    createGC(d, &w, s, 2, &rectGc, rect, &rectColor);
-    createGC(d, &w, s, 2, &pointGc, pointColour, &pointColor);
-    createGC(d, &w, s, 1, &curveGc, curve, &curveColor);
+    rectGc = xcacheGC(resources, rect, lineWidth);
+    pointGc = xcacheGC(resources, pointColour, lineWidth);
+    curveGc = xcacheGC(resources, curve, lineWidth / 2);
 
     invGc = XCreateGC(d, w, 0, 0);
     XSetForeground(d, invGc, WhitePixel(d, s));
     XSetBackground(d, invGc, WhitePixel(d, s));
     XSetFillStyle(d, invGc, FillSolid);
 
+    view.d = d;
+    view.w = w;
+    view.canvas = XCreatePixmap(d, w, windowWidth, windowHeight, DefaultDepth(d, s));
+    view.textGc = textGc;
+    view.pointGc = pointGc;
+    view.curveGc = curveGc;
+    view.invGc = invGc;
+    view.scene = &curves;
+    view.selected = -1;
+    view.noOfSegments = view.noOfDots = 0;
+    view.inside = insideRectangle();
+    view.frame = NULL;
+    /* live frames drawn in software and presented with one request */
+    if (software && xframeInit(&frame, d, s, windowWidth, windowHeight) < 0)
+        fprintf(stderr, "%s: the display does not take 32 bit RGB images, drawing with Xlib\n", argv[0]);
+    else if (software) {
+        if (!frame.shared)
+            fprintf(stderr, "%s: no shared memory with the display, frames go through the connection\n", argv[0]);
+        view.frame = &frame;
+        view.textPixel = rasterColour(text);
+        view.pointPixel = rasterColour(pointColour);
+        view.curvePixel = rasterColour(curve);
+    }
+    /* the world is the window until something is loaded */
+    fitView(&view);
+    if (curves.noOfCurves) {
+        live = true;
+        startLive(&view, rectGc);
+    }
+
     while (true) {
         XNextEvent(d, &e);
         switch (e.type) {
             case Expose:
+                if (live && view.frame) {
+                    xframePut(view.frame, w, invGc, e.xexpose.x, e.xexpose.y, e.xexpose.width, e.xexpose.height);
+                    break;
+                } else if (live) {
+                    XCopyArea(d, view.canvas, w, invGc, e.xexpose.x, e.xexpose.y, e.xexpose.width, e.xexpose.height,
+                            e.xexpose.x, e.xexpose.y);
+                    break;
+                }
                 exposeCount++;
                 drawText(d, &w, &textGc, 0, 0, message);
                 XDrawRectangle(d, w, rectGc, rectX, rectY, rectWidth, rectHeight);
                 if (exposeCount == 1)
                     drawText(d, &w, &textGc, rectX + rectWidth / 2 - 180, rectY + rectHeight / 2, "Press <h> for help");
                 break;
+            case ConfigureNotify:
+                /* resizes come in bursts while dragging, only the last one is acted on */
+                while (XCheckTypedWindowEvent(d, w, ConfigureNotify, &e));
+                if (e.xconfigure.width == windowWidth && e.xconfigure.height == windowHeight)
+                    break;
+                layoutResize(e.xconfigure.width, e.xconfigure.height);
+                rectX = (windowWidth - rectWidth) / 2;
+                rectY = (windowHeight - rectHeight) / 2;
+                view.inside = insideRectangle();
+                XFreePixmap(d, view.canvas);
+                view.canvas = XCreatePixmap(d, w, windowWidth, windowHeight, DefaultDepth(d, s));
+                if (view.frame) {
+                    xframeFree(view.frame);
+                    if (xframeInit(&frame, d, s, windowWidth, windowHeight) < 0) {
+                        fprintf(stderr, "%s: no frames of %dx%d, drawing with Xlib\n", argv[0], windowWidth, windowHeight);
+                        view.frame = NULL;
+                    }
+                }
+                /* the view keeps its origin and zoom, the window just shows more or less of the world */
+                if (live)
+                    startLive(&view, rectGc);
+                break;
             case KeyPress:
                 key = XLookupKeysym(&e.xkey, 0);
                 if (key == XK_c) {
-                    if (p) {
-                        free(p);
-                        p = NULL;
-                        noOfPoints = 0;
-                    }
+                    sceneClear(&curves);
+                    p = NULL;
+                    noOfPoints = 0;
+                    live = false;
+                    dragCurve = dragIndex = -1;
+                    view.selected = -1;
+                    fitView(&view);
                     XClearWindow(d, w);
                     drawText(d, &w, &textGc, 0, 0, message);
                     XDrawRectangle(d, w, rectGc, rectX, rectY, rectWidth, rectHeight);
+                } else if (key == XK_m) {
+                    curveMode mode = (curves.mode + 1) % 3;
+                    sceneSetMode(&curves, mode);
+                    XStoreName(d, w, modeName[mode]);
+                    if (live)
+                        renderLive(&view, view.inside);
+                } else if (key == XK_n || key == XK_Delete || key == XK_BackSpace) {
+                    if (!live || view.selected < 0)
+                        break;
+                    /* the next click starts another curve */
+                    damage = curveRectangle(&view, view.selected);
+                    if (key != XK_n) {
+                        sceneRemove(&curves, view.selected);
+                        dragCurve = -1;
+                    }
+                    view.selected = -1;
+                    renderLive(&view, damage);
+                } else if (key == XK_Left || key == XK_Right || key == XK_Up || key == XK_Down) {
+                    if (!live)
+                        break;
+                    view.x += ((key == XK_Right) - (key == XK_Left)) * view.inside.width / 8.0 / view.scale;
+                    view.y += ((key == XK_Down) - (key == XK_Up)) * view.inside.height / 8.0 / view.scale;
+                    renderLive(&view, view.inside);
+                } else if (key == XK_equal || key == XK_plus || key == XK_KP_Add || key == XK_minus || key == XK_KP_Subtract) {
+                    if (live)
+                        zoomView(&view, key == XK_minus || key == XK_KP_Subtract ? 0.8 : 1.25,
+                                view.inside.x + view.inside.width / 2, view.inside.y + view.inside.height / 2);
+                } else if (key == XK_f) {
+                    if (!live)
+                        break;
+                    fitView(&view);
+                    renderLive(&view, view.inside);
                 } else if (key == XK_h) {
                     XClearWindow(d, w);
                     subw = XCreateSimpleWindow(d, w, 0, 0, windowWidth, windowHeight, 0, 0, WhitePixel(d, s));
@@ -170,13 +766,23 @@ int main() {
                                         "* press <left mouse button> inside the rectangle");
                                 drawText(d, &subw, &textGc, rectX - 80, rectY + 80,
                                         "  to generate points");
-                                drawText(d, &subw, &textGc, rectX - 80, rectY + 160,
+                                drawText(d, &subw, &textGc, rectX - 80, rectY + 120,
                                         "* press <right mouse button> to draw bezier curve");
+                                drawText(d, &subw, &textGc, rectX - 80, rectY + 160,
+                                        "* drag a point to reshape the drawn curve");
+                                drawText(d, &subw, &textGc, rectX - 80, rectY + 200,
+                                        "* press <n> to start a new curve, <delete> to remove one");
                                 drawText(d, &subw, &textGc, rectX - 80, rectY + 240,
-                                        "* press <c> to erase all");
+                                        "* <arrows> or <middle mouse button> pan, <wheel> or <+> <-> zoom");
+                                drawText(d, &subw, &textGc, rectX - 80, rectY + 280,
+                                        "* press <f> to fit all curves in the view");
                                 drawText(d, &subw, &textGc, rectX - 80, rectY + 320,
-                                        "* press <h> for help");
+                                        "* press <c> to erase all");
+                                drawText(d, &subw, &textGc, rectX - 80, rectY + 360,
+                                        "* press <m> to switch bezier / b-spline / composite");
                                 drawText(d, &subw, &textGc, rectX - 80, rectY + 400,
+                                        "* press <h> for help");
+                                drawText(d, &subw, &textGc, rectX - 80, rectY + 480,
                                         "* press <any key> to exit from this screen");
                                 break;
                             case KeyPress:
@@ -186,11 +792,67 @@ int main() {
                     }
 end:
                     ;
-                    drawText(d, &w, &textGc, 0, 0, message);
-                    XDrawRectangle(d, w, rectGc, rectX, rectY, rectWidth, rectHeight);
-                } else exit(0);
+                    if (live && view.frame)
+                        xframePut(view.frame, w, invGc, 0, 0, windowWidth, windowHeight);
+                    else if (live)
+                        XCopyArea(d, view.canvas, w, invGc, 0, 0, windowWidth, windowHeight, 0, 0);
+                    else {
+                        drawText(d, &w, &textGc, 0, 0, message);
+                        XDrawRectangle(d, w, rectGc, rectX, rectY, rectWidth, rectHeight);
+                    }
+                } else if (!IsModifierKey(key))
+                    goto quit;
+                break;
+            case MotionNotify:
+                if (dragCurve < 0 && !panning)
+                    break;
+                while (XCheckTypedWindowEvent(d, w, MotionNotify, &e));
+                if (panning) {
+                    view.x -= (e.xmotion.x - panX) / view.scale;
+                    view.y -= (e.xmotion.y - panY) / view.scale;
+                    panX = e.xmotion.x;
+                    panY = e.xmotion.y;
+                    renderLive(&view, view.inside);
+                } else if (checkPointLocation(e.xmotion.x, e.xmotion.y)) {
+                    damage = curveRectangle(&view, dragCurve);
+                    sceneMove(&curves, dragCurve, dragIndex, worldX(&view, e.xmotion.x), worldY(&view, e.xmotion.y));
+                    renderLive(&view, rectUnion(damage, curveRectangle(&view, dragCurve)));
+                }
+                break;
+            case ButtonRelease:
+                if (e.xbutton.button == Button1)
+                    dragCurve = dragIndex = -1;
+                else if (e.xbutton.button == Button2)
+                    panning = false;
                 break;
             case ButtonPress:
+                if (live) {
+                    if (e.xbutton.button == Button1) {
+                        /* the index narrows the search to the curves around the pointer */
+                        dragCurve = scenePick(&curves, worldX(&view, e.xbutton.x), worldY(&view, e.xbutton.y),
+                                2 * pointRadius / view.scale, &dragIndex);
+                        if (dragCurve >= 0 && dragCurve != view.selected)
+                            selectCurve(&view, dragCurve);
+                        else if (dragCurve < 0 && checkPointLocation(e.xbutton.x, e.xbutton.y)) {
+                            damage = curveRectangle(&view, view.selected);
+                            v.x = worldX(&view, e.xbutton.x);
+                            v.y = worldY(&view, e.xbutton.y);
+                            if (view.selected < 0)
+                                view.selected = sceneAdd(&curves, &v, 1);
+                            else if (sceneAppend(&curves, view.selected, v.x, v.y) < 0)
+                                break;
+                            renderLive(&view, rectUnion(damage, curveRectangle(&view, view.selected)));
+                        }
+                    } else if (e.xbutton.button == Button2) {
+                        panning = true;
+                        panX = e.xbutton.x;
+                        panY = e.xbutton.y;
+                    } else if (e.xbutton.button == Button4 || e.xbutton.button == Button5)
+                        zoomView(&view, e.xbutton.button == Button4 ? 1.25 : 0.8, e.xbutton.x, e.xbutton.y);
+                    else if (e.xbutton.button == Button3)
+                        renderLive(&view, view.inside);
+                    break;
+                }
                 if (e.xbutton.button == Button1) {
                     if (exposeCount == 1) {
                         XClearWindow(d, w);
@@ -199,10 +861,13 @@ end:
                         exposeCount++;
                     }
                     if (checkPointLocation(e.xbutton.x, e.xbutton.y)) {
-                        noOfPoints++;
-                        p = (point *) realloc(p, sizeof (point) * noOfPoints);
-                        (p + noOfPoints - 1)->x = e.xbutton.x;
-                        (p + noOfPoints - 1)->y = e.xbutton.y;
+                        v.x = e.xbutton.x;
+                        v.y = e.xbutton.y;
+                        if (view.selected < 0 ? (view.selected = sceneAdd(&curves, &v, 1)) < 0
+                                : sceneAppend(&curves, view.selected, v.x, v.y) < 0)
+                            break;
+                        p = curves.curves[view.selected].ctrl;
+                        noOfPoints = curves.curves[view.selected].n;
                         XFillArc(d, w, pointGc, e.xbutton.x - pointRadius, e.xbutton.y - pointRadius,
                                 pointRadius * 2, pointRadius * 2, 0, 360 * 64);
                         sprintf(buffer, "%d", noOfPoints);
@@ -213,12 +878,12 @@ end:
                 }
                 if (e.xbutton.button == Button3) {
                     if (p) {
-                        int i, j = 1, temp = 0, *textWidth_and_Height[3];
-                        point bezierPrev = *p, bezierNext;
-                        double t;
+                        int j = 1, finished, temp = 0, doneWidth, percentWidth;
+                        bernstein b = {0, NULL, NULL};
+                        sampleJob job;
                         for (i = 0; i < noOfPoints; i++) {
                             sprintf(buffer, "%d", i + 1);
-                            drawText(d, &w, &invGc, (p + i)->x, (p + i)->y, buffer);
+                            drawTextWidth(d, &w, &invGc, (p + i)->x, (p + i)->y, buffer);
                             XFillArc(d, w, invGc, (p + i)->x - pointRadius, (p + i)->y - pointRadius,
                                     pointRadius * 2, pointRadius * 2, 0, 360 * 64);
                             XFillArc(d, w, pointGc, (p + i)->x - pointRadius / 2, (p + i)->y - pointRadius / 2,
@@ -226,52 +891,75 @@ end:
                         }
                         for (i = 0; i < noOfPoints - 1; i++)
                             XDrawLine(d, w, textGc, p[i].x, p[i].y, p[i + 1].x, p[i + 1].y);
-                        drawText(d, &w, &invGc, rectX + rectWidth / 4, rectY + rectHeight + (windowHeight - rectHeight) / 4,
+                        drawTextWidth(d, &w, &invGc, rectX + rectWidth / 4, rectY + rectHeight + (windowHeight - rectHeight) / 4,
                             "Done   % [                                          ]");
-                        textWidth_and_Height[0] = drawText(d, &w, &textGc, rectX + rectWidth / 4, rectY + rectHeight + (windowHeight - rectHeight) / 4,
+                        doneWidth = drawTextWidth(d, &w, &textGc, rectX + rectWidth / 4, rectY + rectHeight + (windowHeight - rectHeight) / 4,
                             "Done ");
-                        textWidth_and_Height[1] = drawText(d, &w, &textGc, rectX + rectWidth / 4 + *textWidth_and_Height[0], rectY + rectHeight + (windowHeight - rectHeight) / 4,
+                        percentWidth = drawTextWidth(d, &w, &textGc, rectX + rectWidth / 4 + doneWidth, rectY + rectHeight + (windowHeight - rectHeight) / 4,
                             "  % [");
-                        drawText(d, &w, &textGc, rectX + rectWidth / 4 + *textWidth_and_Height[0]+ *textWidth_and_Height[1],
+                        drawTextWidth(d, &w, &textGc, rectX + rectWidth / 4 + doneWidth + percentWidth,
                                 rectY + rectHeight + (windowHeight - rectHeight) / 4,
                                 "                                          ]");
-                        for (t = 0; t <= 1; t += 0.0000008) {
-                            bezierNext.x = bezierNext.y = 0;
-                            for (i = 0; i < noOfPoints; i++) {
-                                bezierNext.x += nCr(noOfPoints - 1, i) * pow(1 - t, noOfPoints - 1 - i) * pow(t, i) * ((p + i)->x);
-                                bezierNext.y += nCr(noOfPoints - 1, i) * pow(1 - t, noOfPoints - 1 - i) * pow(t, i) * ((p + i)->y);
-                            }
-                            XDrawLine(d, w, curveGc, bezierPrev.x, bezierPrev.y, bezierNext.x, bezierNext.y);
-                            i = t * 100;
-                            if (i == j) {
-                                j++;
-                                sprintf(buffer, "%2d", i);
-                                drawText(d, &w, &invGc, rectX + rectWidth / 4 + *textWidth_and_Height[0],
-                                        rectY + rectHeight + (windowHeight - rectHeight) / 4, buffer);
-                                drawText(d, &w, &textGc, rectX + rectWidth / 4 + *textWidth_and_Height[0],
-                                        rectY + rectHeight + (windowHeight - rectHeight) / 4, buffer);
-                                if (i % 5 == 1) {
-                                    textWidth_and_Height[2] = drawText(d, &w, &textGc, rectX + rectWidth / 4 + *textWidth_and_Height[0]+ *textWidth_and_Height[1] + temp,
+                        start = traceNow();
+                        finished = curves.mode != bezierMode || noOfPoints <= SUBDIVISION_MAX_POINTS || bernsteinInit(&b, p, noOfPoints) < 0;
+                        /* flattened at the level of detail live mode shows first, so it is kept */
+                        if (!finished && sampleJobStart(&job, &b, bezierSampleCount(p, noOfPoints, sceneLevelTolerance(tolerance)),
+                                threads, &curvePoints) < 0) {
+                            bernsteinFree(&b);
+                            finished = true;
+                        }
+                        if (finished)
+                            scenePolyline(&curves, view.selected, tolerance);
+                        /* the workers own the evaluation; this thread only repaints the bar */
+                        do {
+                            if (!finished)
+                                finished = sampleJobWait(&job, 1000 / progressRate);
+                            i = finished ? 100 : sampleJobProgress(&job);
+                            if (i < j)
+                                continue;
+                            for (; j <= i; j++)
+                                if (j % 5 == 1) {
+                                    temp += drawTextWidth(d, &w, &textGc, rectX + rectWidth / 4 + doneWidth + percentWidth + temp,
                                             rectY + rectHeight + (windowHeight - rectHeight) / 4, "==");
-                                    temp += *textWidth_and_Height[2];
                                 }
-                            }
-                            bezierPrev.x = bezierNext.x;
-                            bezierPrev.y = bezierNext.y;
+                            sprintf(buffer, "%2d", i);
+                            drawTextWidth(d, &w, &invGc, rectX + rectWidth / 4 + doneWidth,
+                                    rectY + rectHeight + (windowHeight - rectHeight) / 4, "100%");
+                            drawTextWidth(d, &w, &textGc, rectX + rectWidth / 4 + doneWidth,
+                                    rectY + rectHeight + (windowHeight - rectHeight) / 4, buffer);
+                            XFlush(d);
+                        } while (!finished);
+                        if (b.x) {
+                            bernsteinFree(&b);
+                            sceneSetPolyline(&curves, view.selected, &curvePoints, sceneLevelTolerance(tolerance));
                         }
-                        drawText(d, &w, &invGc, rectX + rectWidth / 4 + *textWidth_and_Height[0],
-                                rectY + rectHeight + (windowHeight - rectHeight) / 4, buffer);
-                        drawText(d, &w, &textGc, rectX + rectWidth / 4 + *textWidth_and_Height[0],
-                                rectY + rectHeight + (windowHeight - rectHeight) / 4, "100%");
-                        drawText(d, &w, &textGc, rectX + rectWidth / 4 + *textWidth_and_Height[0]+ *textWidth_and_Height[1] + temp,
+                        traceRecord(trace, "flatten", 0, start, traceNow(), -1);
+                        if (sceneShown(&curves, view.selected))
+                            drawPolyline(d, w, curveGc, sceneShown(&curves, view.selected)->v,
+                                    sceneShown(&curves, view.selected)->count);
+                        drawTextWidth(d, &w, &textGc, rectX + rectWidth / 4 + doneWidth + percentWidth + temp,
                                 rectY + rectHeight + (windowHeight - rectHeight) / 4, "==");
-                        free(p);
+                        drawTextWidth(d, &w, &textGc, rectX + rectWidth / 4 + doneWidth,
+                                rectY + rectHeight + (windowHeight - rectHeight) / 4, "100%");
+                        live = true;
                         p = NULL;
-                        noOfPoints = 0;
+                        startLive(&view, rectGc);
                     }
                 }
         }
     }
+quit:
+    traceReport(trace, traceFile, stats ? stderr : NULL, "frame");
+    if (trace)
+        traceFree(trace);
+    sceneFree(&curves);
+    polylineFree(&curvePoints);
+    XFreePixmap(d, view.canvas);
+    if (view.frame)
+        xframeFree(view.frame);
+    XFreeGC(d, textGc);
+    XFreeGC(d, invGc);
+    xcacheClose(resources);
     XDestroyWindow(d, w);
     XCloseDisplay(d);
     return (EXIT_SUCCESS);
@@ -0,0 +1,653 @@
+/*
+ * File:   curve.c
+ * Author: dibyendu
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include "curve.h"
+
+#define MAX_SUBDIVISION_DEPTH 24
+
+void
+polylineInit(polyline *pl) {
+    pl->v = NULL;
+    pl->count = pl->capacity = 0;
+}
+
+void
+polylineFree(polyline *pl) {
+    free(pl->v);
+    polylineInit(pl);
+}
+
+int
+polylineReserve(polyline *pl, int count) {
+    int capacity = pl->capacity ? pl->capacity : 256;
+    vertex *v;
+
+    if (count <= pl->capacity)
+        return 0;
+    while (capacity < count)
+        capacity *= 2;
+    v = (vertex *) realloc(pl->v, sizeof (vertex) * capacity);
+    if (!v)
+        return -1;
+    pl->v = v;
+    pl->capacity = capacity;
+    return 0;
+}
+
+int
+polylineAppend(polyline *pl, double x, double y) {
+    if (pl->count == pl->capacity && polylineReserve(pl, pl->count + 1) < 0)
+        return -1;
+    pl->v[pl->count].x = x;
+    pl->v[pl->count].y = y;
+    return pl->count++;
+}
+
+/*
+ * Largest squared distance of the inner control points from the chord
+ * c[0] -> c[n - 1], the segment and not the line through it, so points
+ * beyond its ends count by their distance to the nearer end. By the
+ * convex hull property the curve can not be any further than that from
+ * the chord.
+ */
+static double
+flatness(const vertex *c, int n) {
+    double dx = c[n - 1].x - c[0].x, dy = c[n - 1].y - c[0].y, len = dx * dx + dy * dy, max = 0, d, t;
+    int i;
+    for (i = 1; i < n - 1; i++) {
+        double ex = c[i].x - c[0].x, ey = c[i].y - c[0].y;
+        t = len > 0 ? (ex * dx + ey * dy) / len : 0;
+        if (t <= 0)
+            d = ex * ex + ey * ey;
+        else if (t >= 1)
+            d = (c[i].x - c[n - 1].x) * (c[i].x - c[n - 1].x) + (c[i].y - c[n - 1].y) * (c[i].y - c[n - 1].y);
+        else {
+            d = ex * dy - ey * dx;
+            d = d * d / len;
+        }
+        if (d > max)
+            max = d;
+    }
+    return max;
+}
+
+/*
+ * Splits c at t = 0.5; left and right receive n control points each and
+ * work is scratch space of n vertices.
+ */
+static void
+subdivide(const vertex *c, int n, vertex *left, vertex *right, vertex *work) {
+    int i, k;
+    memcpy(work, c, sizeof (vertex) * n);
+    for (k = 0; k < n; k++) {
+        left[k] = work[0];
+        right[n - 1 - k] = work[n - 1 - k];
+        for (i = 0; i < n - 1 - k; i++) {
+            work[i].x = (work[i].x + work[i + 1].x) * 0.5;
+            work[i].y = (work[i].y + work[i + 1].y) * 0.5;
+        }
+    }
+}
+
+static int
+flatten(const vertex *c, int n, double tolerance2, int depth, vertex *levels, vertex *work, polyline *out) {
+    if (depth == MAX_SUBDIVISION_DEPTH || flatness(c, n) <= tolerance2)
+        return polylineAppend(out, c[n - 1].x, c[n - 1].y);
+    vertex *left = levels, *right = levels + n;
+    subdivide(c, n, left, right, work);
+    if (flatten(left, n, tolerance2, depth + 1, levels + 2 * n, work, out) < 0)
+        return -1;
+    return flatten(right, n, tolerance2, depth + 1, levels + 2 * n, work, out);
+}
+
+int
+bezierFlatten(const vertex *ctrl, int n, double tolerance, polyline *out) {
+    vertex *scratch;
+
+    out->count = 0;
+    if (n < 1)
+        return 0;
+    if (polylineAppend(out, ctrl[0].x, ctrl[0].y) < 0)
+        return -1;
+    if (n == 1)
+        return out->count;
+
+    scratch = (vertex *) malloc(sizeof (vertex) * n * (2 * MAX_SUBDIVISION_DEPTH + 1));
+    if (!scratch)
+        return -1;
+    n = flatten(ctrl, n, tolerance * tolerance, 0, scratch + n, scratch, out);
+    free(scratch);
+    return n < 0 ? -1 : out->count;
+}
+
+#define SAMPLE_BATCH 256
+#define MAX_SAMPLE_COUNT (1 << 20)
+
+typedef double v4d __attribute__ ((vector_size(4 * sizeof (double))));
+
+int
+bernsteinInit(bernstein *b, const vertex *ctrl, int n) {
+    double c = 1;
+    int i;
+
+    b->n = 0;
+    b->x = b->y = NULL;
+    if (n < 1)
+        return -1;
+    b->x = (double *) malloc(sizeof (double) * n);
+    b->y = (double *) malloc(sizeof (double) * n);
+    if (!b->x || !b->y) {
+        bernsteinFree(b);
+        return -1;
+    }
+    b->n = n;
+    for (i = 0; i < n; i++) {
+        b->x[i] = c * ctrl[i].x;
+        b->y[i] = c * ctrl[i].y;
+        if (n <= BERNSTEIN_MAX_POINTS)
+            c = c * (n - 1 - i) / (i + 1);
+    }
+    return 0;
+}
+
+void
+bernsteinFree(bernstein *b) {
+    free(b->x);
+    free(b->y);
+    b->x = b->y = NULL;
+    b->n = 0;
+}
+
+static double
+ipow(double base, int e) {
+    double r = 1;
+    for (; e; e >>= 1, base *= base)
+        if (e & 1)
+            r *= base;
+    return r;
+}
+
+/*
+ * Past BERNSTEIN_MAX_POINTS the coefficients no longer fit in a double and
+ * b holds the bare control points. The basis weights are binomial in i and
+ * fall off geometrically either side of the mode floor(nt), so walking out
+ * from it by their ratios until they drop below WIDE_CUTOFF costs about
+ * sqrt(n) terms per sample.
+ */
+#define WIDE_CUTOFF 1e-18
+
+static vertex
+wideEvaluate(const bernstein *b, double t) {
+    int i, k, m = b->n - 1;
+    double r, w, sum = 1, x, y;
+    vertex v;
+
+    k = (int) (t * b->n);
+    if (t <= 0 || k > m)
+        k = t <= 0 ? 0 : m;
+    x = b->x[k];
+    y = b->y[k];
+    if (t <= 0 || t >= 1) {
+        v.x = x;
+        v.y = y;
+        return v;
+    }
+    r = t / (1 - t);
+    for (i = k, w = 1; i < m && w > WIDE_CUTOFF; i++) {
+        w *= r * (m - i) / (i + 1);
+        x += w * b->x[i + 1];
+        y += w * b->y[i + 1];
+        sum += w;
+    }
+    for (i = k, w = 1; i > 0 && w > WIDE_CUTOFF; i--) {
+        w *= i / (r * (m - i + 1));
+        x += w * b->x[i - 1];
+        y += w * b->y[i - 1];
+        sum += w;
+    }
+    v.x = x / sum;
+    v.y = y / sum;
+    return v;
+}
+
+vertex
+bernsteinEvaluate(const bernstein *b, double t) {
+    int i, m = b->n - 1;
+    double s, x, y, scale;
+    vertex v;
+
+    if (b->n > BERNSTEIN_MAX_POINTS)
+        return wideEvaluate(b, t);
+    if (t <= 0.5) {
+        s = t / (1 - t);
+        x = b->x[m];
+        y = b->y[m];
+        for (i = m - 1; i >= 0; i--) {
+            x = x * s + b->x[i];
+            y = y * s + b->y[i];
+        }
+        scale = ipow(1 - t, m);
+    } else {
+        s = (1 - t) / t;
+        x = b->x[0];
+        y = b->y[0];
+        for (i = 1; i <= m; i++) {
+            x = x * s + b->x[i];
+            y = y * s + b->y[i];
+        }
+        scale = ipow(t, m);
+    }
+    v.x = x * scale;
+    v.y = y * scale;
+    return v;
+}
+
+/*
+ * Four parameters that all lie on the same side of 0.5; mirrors
+ * bernsteinEvaluate lane for lane.
+ */
+static void
+evaluate4(const bernstein *b, const double *t, double *x, double *y) {
+    const v4d zero = {0, 0, 0, 0}, one = {1, 1, 1, 1};
+    v4d tv = {t[0], t[1], t[2], t[3]}, s, ax, ay, base, scale = one;
+    int i, e, m = b->n - 1;
+
+    if (t[0] <= 0.5) {
+        s = tv / (one - tv);
+        ax = zero + b->x[m];
+        ay = zero + b->y[m];
+        for (i = m - 1; i >= 0; i--) {
+            ax = ax * s + b->x[i];
+            ay = ay * s + b->y[i];
+        }
+        base = one - tv;
+    } else {
+        s = (one - tv) / tv;
+        ax = zero + b->x[0];
+        ay = zero + b->y[0];
+        for (i = 1; i <= m; i++) {
+            ax = ax * s + b->x[i];
+            ay = ay * s + b->y[i];
+        }
+        base = tv;
+    }
+    for (e = m; e; e >>= 1, base *= base)
+        if (e & 1)
+            scale *= base;
+    ax *= scale;
+    ay *= scale;
+    for (i = 0; i < 4; i++) {
+        x[i] = ax[i];
+        y[i] = ay[i];
+    }
+}
+
+void
+bernsteinEvaluateMany(const bernstein *b, const double *t, int count, double *x, double *y) {
+    int i, j;
+    for (i = 0; i + 4 <= count; i += 4) {
+        int low = (t[i] <= 0.5) + (t[i + 1] <= 0.5) + (t[i + 2] <= 0.5) + (t[i + 3] <= 0.5);
+        if ((low == 0 || low == 4) && b->n <= BERNSTEIN_MAX_POINTS)
+            evaluate4(b, t + i, x + i, y + i);
+        else
+            for (j = i; j < i + 4; j++) {
+                vertex v = bernsteinEvaluate(b, t[j]);
+                x[j] = v.x;
+                y[j] = v.y;
+            }
+    }
+    for (; i < count; i++) {
+        vertex v = bernsteinEvaluate(b, t[i]);
+        x[i] = v.x;
+        y[i] = v.y;
+    }
+}
+
+int
+bezierSampleCount(const vertex *ctrl, int n, double tolerance) {
+    double max = 0, bound;
+    int i;
+
+    for (i = 0; i + 2 < n; i++) {
+        double dx = ctrl[i].x - 2 * ctrl[i + 1].x + ctrl[i + 2].x,
+               dy = ctrl[i].y - 2 * ctrl[i + 1].y + ctrl[i + 2].y,
+               d = sqrt(dx * dx + dy * dy);
+        if (d > max)
+            max = d;
+    }
+    bound = ceil(sqrt((double) (n - 1) * (n - 2) * max / (8 * tolerance)));
+    if (bound < 1)
+        return 1;
+    return bound > MAX_SAMPLE_COUNT ? MAX_SAMPLE_COUNT : (int) bound;
+}
+
+int
+bezierSample(const bernstein *b, int segments, polyline *out) {
+    double t[SAMPLE_BATCH], x[SAMPLE_BATCH], y[SAMPLE_BATCH];
+    int i, j, count;
+
+    out->count = 0;
+    for (i = 0; i <= segments; i += count) {
+        count = segments + 1 - i < SAMPLE_BATCH ? segments + 1 - i : SAMPLE_BATCH;
+        for (j = 0; j < count; j++)
+            t[j] = (double) (i + j) / segments;
+        bernsteinEvaluateMany(b, t, count, x, y);
+        for (j = 0; j < count; j++)
+            polylineAppend(out, x[j], y[j]);
+    }
+    return out->count == segments + 1 ? out->count : -1;
+}
+
+typedef struct {
+    sampleJob *job;
+    int first, last;
+} sampleSlice;
+
+static void *
+sampleWorker(void *arg) {
+    sampleSlice *slice = (sampleSlice *) arg;
+    sampleJob *job = slice->job;
+    double t[SAMPLE_BATCH], x[SAMPLE_BATCH], y[SAMPLE_BATCH];
+    int i, j, count;
+
+    for (i = slice->first; i < slice->last; i += count) {
+        count = slice->last - i < SAMPLE_BATCH ? slice->last - i : SAMPLE_BATCH;
+        for (j = 0; j < count; j++)
+            t[j] = (double) (i + j) / job->segments;
+        bernsteinEvaluateMany(job->b, t, count, x, y);
+        for (j = 0; j < count; j++) {
+            job->out[i + j].x = x[j];
+            job->out[i + j].y = y[j];
+        }
+        atomic_fetch_add_explicit(&job->done, count, memory_order_relaxed);
+    }
+
+    pthread_mutex_lock(&job->lock);
+    if (--job->running == 0)
+        pthread_cond_signal(&job->finished);
+    pthread_mutex_unlock(&job->lock);
+    free(slice);
+    return NULL;
+}
+
+int
+sampleJobStart(sampleJob *job, const bernstein *b, int segments, int threads, polyline *out) {
+    int i, samples = segments + 1;
+
+    if (threads < 1)
+        threads = 1;
+    if (threads > samples)
+        threads = samples;
+    if (polylineReserve(out, samples) < 0)
+        return -1;
+    out->count = samples;
+
+    job->b = b;
+    job->out = out->v;
+    job->segments = segments;
+    job->threads = job->running = 0;
+    atomic_init(&job->done, 0);
+    job->workers = (pthread_t *) malloc(sizeof (pthread_t) * threads);
+    if (!job->workers)
+        return -1;
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->finished, NULL);
+
+    pthread_mutex_lock(&job->lock);
+    for (i = 0; i < threads; i++) {
+        sampleSlice *slice = (sampleSlice *) malloc(sizeof (sampleSlice));
+        if (!slice)
+            break;
+        slice->job = job;
+        slice->first = (long long) samples * i / threads;
+        slice->last = (long long) samples * (i + 1) / threads;
+        if (pthread_create(job->workers + i, NULL, sampleWorker, slice)) {
+            free(slice);
+            break;
+        }
+        job->threads++;
+        job->running++;
+    }
+    pthread_mutex_unlock(&job->lock);
+
+    if (job->threads < threads) {
+        /* Threads that did start cover only their own slices. */
+        sampleJobWait(job, -1);
+        return -1;
+    }
+    return 0;
+}
+
+int
+sampleJobProgress(sampleJob *job) {
+    return (long long) atomic_load_explicit(&job->done, memory_order_relaxed) * 100 / (job->segments + 1);
+}
+
+int
+sampleJobWait(sampleJob *job, int milliseconds) {
+    struct timespec deadline;
+    int i, running;
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += milliseconds / 1000;
+    deadline.tv_nsec += (milliseconds % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&job->lock);
+    while (job->running)
+        if (milliseconds < 0)
+            pthread_cond_wait(&job->finished, &job->lock);
+        else if (pthread_cond_timedwait(&job->finished, &job->lock, &deadline) == ETIMEDOUT)
+            break;
+    running = job->running;
+    pthread_mutex_unlock(&job->lock);
+    if (running)
+        return 0;
+
+    for (i = 0; i < job->threads; i++)
+        pthread_join(job->workers[i], NULL);
+    free(job->workers);
+    pthread_mutex_destroy(&job->lock);
+    pthread_cond_destroy(&job->finished);
+    return 1;
+}
+
+int
+bezierPolyline(const vertex *ctrl, int n, double tolerance, polyline *out) {
+    bernstein b;
+    int count;
+
+    if (n <= SUBDIVISION_MAX_POINTS)
+        return bezierFlatten(ctrl, n, tolerance, out);
+    if (bernsteinInit(&b, ctrl, n) < 0)
+        return -1;
+    count = bezierSample(&b, bezierSampleCount(ctrl, n, tolerance), out);
+    bernsteinFree(&b);
+    return count;
+}
+
+void
+splineInit(splineCache *c, curveMode mode) {
+    c->mode = mode;
+    c->tolerance = 0;
+    c->segments = c->capacity = 0;
+    c->cache = NULL;
+    c->valid = NULL;
+}
+
+void
+splineFree(splineCache *c) {
+    int i;
+    for (i = 0; i < c->capacity; i++)
+        polylineFree(c->cache + i);
+    free(c->cache);
+    free(c->valid);
+    splineInit(c, c->mode);
+}
+
+int
+splineSegmentCount(curveMode mode, int n) {
+    switch (mode) {
+        case bsplineMode:
+            return n > 3 ? n - 3 : 0;
+        case compositeMode:
+            return n > 1 ? n - 1 : 0;
+        default:
+            return n > 1 ? 1 : 0;
+    }
+}
+
+void
+splineSegment(curveMode mode, const vertex *ctrl, int n, int i, vertex bez[4]) {
+    if (mode == bsplineMode) {
+        const vertex *p = ctrl + i;
+        bez[0].x = (p[0].x + 4 * p[1].x + p[2].x) / 6;
+        bez[0].y = (p[0].y + 4 * p[1].y + p[2].y) / 6;
+        bez[1].x = (2 * p[1].x + p[2].x) / 3;
+        bez[1].y = (2 * p[1].y + p[2].y) / 3;
+        bez[2].x = (p[1].x + 2 * p[2].x) / 3;
+        bez[2].y = (p[1].y + 2 * p[2].y) / 3;
+        bez[3].x = (p[1].x + 4 * p[2].x + p[3].x) / 6;
+        bez[3].y = (p[1].y + 4 * p[2].y + p[3].y) / 6;
+    } else {
+        /* end tangents reuse the end points themselves */
+        const vertex *prev = ctrl + (i > 0 ? i - 1 : 0), *next = ctrl + (i + 2 < n ? i + 2 : n - 1);
+        bez[0] = ctrl[i];
+        bez[3] = ctrl[i + 1];
+        bez[1].x = ctrl[i].x + (ctrl[i + 1].x - prev->x) / 6;
+        bez[1].y = ctrl[i].y + (ctrl[i + 1].y - prev->y) / 6;
+        bez[2].x = ctrl[i + 1].x - (next->x - ctrl[i].x) / 6;
+        bez[2].y = ctrl[i + 1].y - (next->y - ctrl[i].y) / 6;
+    }
+}
+
+void
+splineInvalidate(splineCache *c, int k) {
+    int i, first = 0, last = c->capacity - 1;
+    if (k >= 0) {
+        first = c->mode == bsplineMode ? k - 3 : k - 2;
+        last = c->mode == bsplineMode ? k : k + 1;
+    }
+    for (i = first < 0 ? 0 : first; i <= last && i < c->capacity; i++)
+        c->valid[i] = false;
+}
+
+int
+splinePolyline(splineCache *c, const vertex *ctrl, int n, double tolerance, polyline *out) {
+    int i, j, segments = splineSegmentCount(c->mode, n);
+    vertex bez[4];
+
+    if (c->mode == bezierMode)
+        return bezierPolyline(ctrl, n, tolerance, out);
+
+    if (segments > c->capacity) {
+        polyline *cache = (polyline *) realloc(c->cache, sizeof (polyline) * segments);
+        bool *valid;
+        if (!cache)
+            return -1;
+        c->cache = cache;
+        valid = (bool *) realloc(c->valid, sizeof (bool) * segments);
+        if (!valid)
+            return -1;
+        c->valid = valid;
+        for (i = c->capacity; i < segments; i++) {
+            polylineInit(c->cache + i);
+            c->valid[i] = false;
+        }
+        c->capacity = segments;
+    }
+    if (tolerance != c->tolerance) {
+        splineInvalidate(c, -1);
+        c->tolerance = tolerance;
+    }
+    /* segments that were dropped with their points are stale once they come back */
+    for (i = segments; i < c->segments; i++)
+        c->valid[i] = false;
+    c->segments = segments;
+
+    out->count = 0;
+    for (i = 0; i < segments; i++) {
+        if (!c->valid[i]) {
+            splineSegment(c->mode, ctrl, n, i, bez);
+            if (bezierFlatten(bez, 4, tolerance, c->cache + i) < 0)
+                return -1;
+            c->valid[i] = true;
+        }
+        for (j = i ? 1 : 0; j < c->cache[i].count; j++)
+            if (polylineAppend(out, c->cache[i].v[j].x, c->cache[i].v[j].y) < 0)
+                return -1;
+    }
+    return out->count;
+}
+
+static int
+readerReserve(curveReader *r, int n) {
+    if (n > MAX_CURVE_POINTS)
+        return -1;
+    if (n > r->capacity) {
+        size_t capacity = r->capacity ? r->capacity : 64;
+        vertex *ctrl;
+        while (capacity < (size_t) n)
+            capacity *= 2;
+        capacity = capacity > MAX_CURVE_POINTS ? MAX_CURVE_POINTS : capacity;
+        ctrl = (vertex *) realloc(r->ctrl, sizeof (vertex) * capacity);
+        if (!ctrl)
+            return -1;
+        r->ctrl = ctrl;
+        r->capacity = capacity;
+    }
+    return 0;
+}
+
+int
+readCurve(curveReader *r) {
+    if (r->binary) {
+        int32_t count, n, chunk;
+        if (fread(&count, sizeof (count), 1, r->in) != 1)
+            return 0;
+        if (count < 1 || count > MAX_CURVE_POINTS)
+            return -1;
+        /* grown as the points arrive, so a count the file does not hold costs no memory */
+        for (n = 0; n < count; n += chunk) {
+            chunk = count - n < 65536 ? count - n : 65536;
+            if (readerReserve(r, n + chunk) < 0 || fread(r->ctrl + n, sizeof (vertex), chunk, r->in) != (size_t) chunk)
+                return -1;
+        }
+        return count;
+    }
+    while (getline(&r->line, &r->lineSize, r->in) > 0) {
+        char *s = r->line, *end;
+        int n = 0;
+        double x, y;
+        while (*s == ' ' || *s == '\t')
+            s++;
+        if (*s == '#' || *s == '\n' || *s == '\r' || !*s)
+            continue;
+        while (true) {
+            x = strtod(s, &end);
+            if (end == s)
+                break;
+            y = strtod(end, &s);
+            if (s == end || readerReserve(r, n + 1) < 0)
+                return -1;
+            r->ctrl[n].x = x;
+            r->ctrl[n].y = y;
+            n++;
+        }
+        return n ? n : -1;
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * File:   curve.h
+ * Author: dibyendu
+ *
+ * Curve math shared by the interactive and batch front ends. Nothing in
+ * here talks to the X server.
+ */
+
+#ifndef CURVE_H
+#define CURVE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+typedef struct {
+    double x, y;
+} vertex;
+
+typedef struct {
+    vertex *v;
+    int count, capacity;
+} polyline;
+
+void polylineInit(polyline *pl);
+void polylineFree(polyline *pl);
+/* Returns the index of the new vertex, or -1 if out of memory. */
+int polylineAppend(polyline *pl, double x, double y);
+int polylineReserve(polyline *pl, int count);
+
+/*
+ * Flattens the bezier curve defined by the n control points in ctrl into
+ * out, replacing its contents. Recursive de Casteljau subdivision stops as
+ * soon as every control point of a piece lies within tolerance (in the same
+ * units as the control points, i.e. pixels) of the piece's chord, so the
+ * polyline never strays further than that from the true curve.
+ * Returns the number of vertices written, or -1 if out of memory.
+ */
+int bezierFlatten(const vertex *ctrl, int n, double tolerance, polyline *out);
+
+/*
+ * Bernstein form of a curve, precomputed once so that a sample costs O(n)
+ * multiply-adds and no pow() calls: x[i] = C(n - 1, i) * P[i].x and the
+ * same for y, stored as a structure of arrays. Samples are evaluated with
+ * Horner's rule in s = t / (1 - t) (or its reciprocal for t > 0.5), and
+ * then scaled by (1 - t)^(n - 1) (or t^(n - 1)). With s in [0, 1] the sum
+ * stays below 2^(n - 1) times the largest coordinate and the scale above
+ * 2^-(n - 1); BERNSTEIN_MAX_POINTS keeps both, and the coefficients, well
+ * inside the range of a double. Longer curves keep the bare control points
+ * and sum only the basis functions that are not negligible at t.
+ */
+typedef struct {
+    int n;
+    double *x, *y;
+} bernstein;
+
+#define BERNSTEIN_MAX_POINTS 900
+
+/* Returns -1 when out of memory. */
+int bernsteinInit(bernstein *b, const vertex *ctrl, int n);
+void bernsteinFree(bernstein *b);
+vertex bernsteinEvaluate(const bernstein *b, double t);
+
+/* Evaluates count parameters at once, four per vector instruction. */
+void bernsteinEvaluateMany(const bernstein *b, const double *t, int count, double *x, double *y);
+
+/*
+ * Number of uniform segments that keeps a polyline through the curve within
+ * tolerance of it, from the bound (n - 1)(n - 2) max|second difference| / 8.
+ */
+int bezierSampleCount(const vertex *ctrl, int n, double tolerance);
+
+/* Fills out with segments + 1 samples at uniformly spaced t. */
+int bezierSample(const bernstein *b, int segments, polyline *out);
+
+/*
+ * Uniform sampling split across a pool of worker threads, each filling its
+ * own slice of the output polyline. done is bumped after every batch so
+ * another thread can watch progress without taking a lock.
+ */
+typedef struct {
+    const bernstein *b;
+    vertex *out;
+    int segments, threads, running;
+    atomic_int done;
+    pthread_t *workers;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+} sampleJob;
+
+/* Returns -1 when out of memory or no worker could be started. */
+int sampleJobStart(sampleJob *job, const bernstein *b, int segments, int threads, polyline *out);
+
+/* Percentage of samples evaluated so far. */
+int sampleJobProgress(sampleJob *job);
+
+/*
+ * Waits up to milliseconds (forever if negative) for the job to finish.
+ * Returns 1 once every worker is done and joined, 0 on timeout.
+ */
+int sampleJobWait(sampleJob *job, int milliseconds);
+
+#define SUBDIVISION_MAX_POINTS 16
+
+/*
+ * Picks the cheaper of bezierFlatten and uniform Bernstein sampling for the
+ * degree at hand; subdivision costs O(n^2) per split so it only wins for
+ * short control polygons.
+ */
+int bezierPolyline(const vertex *ctrl, int n, double tolerance, polyline *out);
+
+/*
+ * Piecewise alternatives to one global bezier over the same points: a
+ * uniform cubic B-spline, and a C1 composite of cubic beziers through the
+ * points with Catmull-Rom tangents. Every segment depends on just four
+ * points, so it is flattened on its own and cached; editing a point only
+ * invalidates the (at most four) segments that use it.
+ */
+typedef enum {
+    bezierMode, bsplineMode, compositeMode
+} curveMode;
+
+typedef struct {
+    curveMode mode;
+    double tolerance;
+    int segments, capacity;
+    polyline *cache;
+    bool *valid;
+} splineCache;
+
+void splineInit(splineCache *c, curveMode mode);
+void splineFree(splineCache *c);
+int splineSegmentCount(curveMode mode, int n);
+
+/* Cubic bezier control points of segment i. */
+void splineSegment(curveMode mode, const vertex *ctrl, int n, int i, vertex bez[4]);
+
+/* Marks the segments that use point k, or all of them if k is negative. */
+void splineInvalidate(splineCache *c, int k);
+
+/*
+ * Reflattens stale segments and joins them all into out. Falls back to
+ * bezierPolyline in bezierMode.
+ */
+int splinePolyline(splineCache *c, const vertex *ctrl, int n, double tolerance, polyline *out);
+
+/*
+ * Control point sets read from a file, as the batch front end takes them.
+ * Text input has one curve per line as whitespace separated x y pairs;
+ * blank lines and lines starting with '#' are skipped. Binary input starts
+ * with the four bytes "BEZ1" followed by records of a native int32 point
+ * count and that many native double x, y pairs. Curves of more than
+ * MAX_CURVE_POINTS points are malformed in either form. The points of the
+ * last curve read are in ctrl.
+ */
+#define MAX_CURVE_POINTS (1 << 24)
+
+typedef struct {
+    FILE *in;
+    bool binary;
+    char *line;
+    size_t lineSize;
+    vertex *ctrl;
+    int capacity;
+} curveReader;
+
+/* Returns the number of points in the next curve, 0 at end of input, -1 on error. */
+int readCurve(curveReader *r);
+
+#endif
@@ -0,0 +1,609 @@
+/*
+ * File:   scene.c
+ * Author: dibyendu
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "scene.h"
+
+/* Vertices in a slab; blocks bigger than a quarter of it get a slab of their own. */
+#define SLAB_VERTICES (1 << 16)
+
+void
+poolInit(vertexPool *p) {
+    memset(p, 0, sizeof (vertexPool));
+}
+
+void
+poolFree(vertexPool *p) {
+    int i;
+    for (i = 0; i < p->noOfSlabs; i++)
+        free(p->slabs[i]);
+    free(p->slabs);
+    poolInit(p);
+}
+
+static int
+sizeClass(int count) {
+    int k = 0;
+    while (k < POOL_CLASSES && (4 << k) < count)
+        k++;
+    return k;
+}
+
+void
+poolRelease(vertexPool *p, vertex *v, int capacity) {
+    int k = sizeClass(capacity);
+    if (!v)
+        return;
+    *(vertex **) v = p->free[k];
+    p->free[k] = v;
+}
+
+vertex *
+poolAlloc(vertexPool *p, int count, int *capacity) {
+    int k = sizeClass(count), size, slab;
+    vertex *v;
+
+    if (k == POOL_CLASSES)
+        return NULL;
+    size = 4 << k;
+    if ((v = p->free[k])) {
+        p->free[k] = *(vertex **) v;
+        *capacity = size;
+        return v;
+    }
+    if (size > p->left) {
+        if (p->noOfSlabs == p->slabCapacity) {
+            int slabCapacity = p->slabCapacity ? p->slabCapacity * 2 : 16;
+            vertex **slabs = (vertex **) realloc(p->slabs, sizeof (vertex *) * slabCapacity);
+            if (!slabs)
+                return NULL;
+            p->slabs = slabs;
+            p->slabCapacity = slabCapacity;
+        }
+        slab = size > SLAB_VERTICES / 4 ? size : SLAB_VERTICES;
+        if (!(v = (vertex *) malloc(sizeof (vertex) * slab)))
+            return NULL;
+        p->slabs[p->noOfSlabs++] = v;
+        *capacity = size;
+        if (slab == size)
+            return v;
+        /* the rest of the old slab is not lost, it goes to the free lists in pieces */
+        while (p->left >= 4) {
+            int j = sizeClass(p->left + 1) - 1;
+            poolRelease(p, p->next, 4 << j);
+            p->next += 4 << j;
+            p->left -= 4 << j;
+        }
+        p->next = v;
+        p->left = slab;
+    }
+    v = p->next;
+    p->next += size;
+    p->left -= size;
+    *capacity = size;
+    return v;
+}
+
+/* Clamped so that the difference of any two cells still fits in an int. */
+static int
+cellOf(double cell, double x) {
+    double c = floor(x / cell);
+    return c < -(1 << 29) ? -(1 << 29) : c > (1 << 29) ? (1 << 29) : (int) c;
+}
+
+static unsigned int
+hashCell(int cx, int cy, int noOfBuckets) {
+    return ((unsigned int) cx * 73856093u ^ (unsigned int) cy * 19349663u) & (noOfBuckets - 1);
+}
+
+/* Cells the box of c covers; true if there are too many for the grid. */
+static bool
+cellsOf(const sceneGrid *g, const sceneCurve *c, int *cx0, int *cy0, int *cx1, int *cy1) {
+    *cx0 = cellOf(g->cell, c->minX);
+    *cy0 = cellOf(g->cell, c->minY);
+    *cx1 = cellOf(g->cell, c->maxX);
+    *cy1 = cellOf(g->cell, c->maxY);
+    return ((double) *cx1 - *cx0 + 1) * ((double) *cy1 - *cy0 + 1) > GRID_MAX_CELLS;
+}
+
+static int
+gridRehash(sceneGrid *g, int noOfBuckets) {
+    int *buckets = (int *) malloc(sizeof (int) * noOfBuckets), i;
+    unsigned int b;
+
+    if (!buckets)
+        return -1;
+    for (i = 0; i < noOfBuckets; i++)
+        buckets[i] = -1;
+    for (i = 0; i < g->noOfEntries; i++)
+        if (g->entries[i].curve >= 0) {
+            b = hashCell(g->entries[i].cx, g->entries[i].cy, noOfBuckets);
+            g->entries[i].next = buckets[b];
+            buckets[b] = i;
+        }
+    free(g->buckets);
+    g->buckets = buckets;
+    g->noOfBuckets = noOfBuckets;
+    return 0;
+}
+
+static int
+gridAdd(sceneGrid *g, int curve, int cx, int cy) {
+    unsigned int b;
+    int i;
+
+    if (g->noOfEntries >= 2 * g->noOfBuckets && gridRehash(g, g->noOfBuckets ? g->noOfBuckets * 2 : 1024) < 0)
+        return -1;
+    if (g->freeEntry >= 0) {
+        i = g->freeEntry;
+        g->freeEntry = g->entries[i].next;
+    } else {
+        if (g->noOfEntries == g->entryCapacity) {
+            int capacity = g->entryCapacity ? g->entryCapacity * 2 : 1024;
+            gridEntry *entries = (gridEntry *) realloc(g->entries, sizeof (gridEntry) * capacity);
+            if (!entries)
+                return -1;
+            g->entries = entries;
+            g->entryCapacity = capacity;
+        }
+        i = g->noOfEntries++;
+    }
+    b = hashCell(cx, cy, g->noOfBuckets);
+    g->entries[i].curve = curve;
+    g->entries[i].cx = cx;
+    g->entries[i].cy = cy;
+    g->entries[i].next = g->buckets[b];
+    g->buckets[b] = i;
+    return 0;
+}
+
+static void
+gridRemove(scene *s, int i) {
+    sceneGrid *g = &s->grid;
+    sceneCurve *c = s->curves + i;
+    int cx, cy, j, *link;
+
+    if (c->large) {
+        for (j = 0; j < g->noOfLarge; j++)
+            if (g->large[j] == i) {
+                g->large[j] = g->large[--g->noOfLarge];
+                break;
+            }
+        c->large = false;
+        return;
+    }
+    for (cx = c->cx0; cx <= c->cx1; cx++)
+        for (cy = c->cy0; cy <= c->cy1; cy++)
+            for (link = g->buckets + hashCell(cx, cy, g->noOfBuckets); *link >= 0; link = &g->entries[*link].next) {
+                gridEntry *e = g->entries + *link;
+                if (e->curve == i && e->cx == cx && e->cy == cy) {
+                    j = *link;
+                    *link = e->next;
+                    e->curve = -1;
+                    e->next = g->freeEntry;
+                    g->freeEntry = j;
+                    break;
+                }
+            }
+}
+
+static void
+gridInsert(scene *s, int i) {
+    sceneGrid *g = &s->grid;
+    sceneCurve *c = s->curves + i;
+    int cx, cy;
+
+    c->large = cellsOf(g, c, &c->cx0, &c->cy0, &c->cx1, &c->cy1);
+    for (cx = c->cx0; !c->large && cx <= c->cx1; cx++)
+        for (cy = c->cy0; !c->large && cy <= c->cy1; cy++)
+            if (gridAdd(g, i, cx, cy) < 0) {
+                /* the large list finds it all the same, just not as fast */
+                gridRemove(s, i);
+                c->large = true;
+            }
+    if (c->large)
+        g->large[g->noOfLarge++] = i;
+}
+
+static void
+gridRebuild(scene *s, double cell) {
+    sceneGrid *g = &s->grid;
+    int i, *large = g->large, largeCapacity = g->largeCapacity;
+
+    free(g->buckets);
+    free(g->entries);
+    memset(g, 0, sizeof (sceneGrid));
+    g->cell = cell;
+    g->freeEntry = -1;
+    g->large = large;
+    g->largeCapacity = largeCapacity;
+    for (i = 0; i < s->count; i++)
+        if (s->curves[i].used)
+            gridInsert(s, i);
+}
+
+/*
+ * Box of the control points, which holds the whole curve by the convex
+ * hull property, except in composite mode where the tangents can take a
+ * segment outside; its own bezier points bound it then.
+ */
+static void
+curveBounds(const scene *s, sceneCurve *c) {
+    vertex bez[4];
+    int j, k;
+
+    c->minX = c->maxX = c->ctrl->x;
+    c->minY = c->maxY = c->ctrl->y;
+    for (j = 1; j < c->n; j++) {
+        c->minX = c->ctrl[j].x < c->minX ? c->ctrl[j].x : c->minX;
+        c->maxX = c->ctrl[j].x > c->maxX ? c->ctrl[j].x : c->maxX;
+        c->minY = c->ctrl[j].y < c->minY ? c->ctrl[j].y : c->minY;
+        c->maxY = c->ctrl[j].y > c->maxY ? c->ctrl[j].y : c->maxY;
+    }
+    if (s->mode != compositeMode)
+        return;
+    for (j = 0; j < splineSegmentCount(s->mode, c->n); j++) {
+        splineSegment(s->mode, c->ctrl, c->n, j, bez);
+        for (k = 1; k < 3; k++) {
+            c->minX = bez[k].x < c->minX ? bez[k].x : c->minX;
+            c->maxX = bez[k].x > c->maxX ? bez[k].x : c->maxX;
+            c->minY = bez[k].y < c->minY ? bez[k].y : c->minY;
+            c->maxY = bez[k].y > c->maxY ? bez[k].y : c->maxY;
+        }
+    }
+}
+
+static void
+invalidateTiers(sceneCurve *c) {
+    int t;
+    for (t = 0; t < SCENE_TIERS; t++)
+        c->tiers[t].valid = false;
+    c->shown = -1;
+}
+
+/* After control point k of curve i changed: stale polylines, new box, and new cells if it moved out of its own. */
+static void
+curveChanged(scene *s, int i, int k) {
+    sceneCurve *c = s->curves + i;
+    int cx0, cy0, cx1, cy1;
+    bool large;
+
+    invalidateTiers(c);
+    if (i == s->splineCurve)
+        splineInvalidate(&s->spline, k);
+    curveBounds(s, c);
+    large = cellsOf(&s->grid, c, &cx0, &cy0, &cx1, &cy1);
+    if (large && c->large)
+        return;
+    if (!large && !c->large && cx0 == c->cx0 && cy0 == c->cy0 && cx1 == c->cx1 && cy1 == c->cy1)
+        return;
+    gridRemove(s, i);
+    gridInsert(s, i);
+}
+
+void
+sceneInit(scene *s, curveMode mode, double cell) {
+    memset(s, 0, sizeof (scene));
+    s->mode = mode;
+    poolInit(&s->pool);
+    s->freeCurve = -1;
+    s->grid.cell = cell;
+    s->grid.freeEntry = -1;
+    splineInit(&s->spline, mode);
+    s->splineCurve = -1;
+    polylineInit(&s->scratch);
+}
+
+void
+sceneFree(scene *s) {
+    poolFree(&s->pool);
+    free(s->curves);
+    free(s->grid.buckets);
+    free(s->grid.entries);
+    free(s->grid.large);
+    splineFree(&s->spline);
+    polylineFree(&s->scratch);
+    free(s->found);
+    memset(s, 0, sizeof (scene));
+}
+
+void
+sceneClear(scene *s) {
+    curveMode mode = s->mode;
+    double cell = s->grid.cell;
+    sceneFree(s);
+    sceneInit(s, mode, cell);
+}
+
+void
+sceneSetMode(scene *s, curveMode mode) {
+    int i;
+
+    s->mode = mode;
+    splineFree(&s->spline);
+    splineInit(&s->spline, mode);
+    s->splineCurve = -1;
+    for (i = 0; i < s->count; i++)
+        if (s->curves[i].used) {
+            invalidateTiers(s->curves + i);
+            curveBounds(s, s->curves + i);
+        }
+    gridRebuild(s, s->grid.cell);
+}
+
+int
+sceneAdd(scene *s, const vertex *ctrl, int n) {
+    sceneCurve *c;
+    int i, next;
+
+    if (n < 1)
+        return -1;
+    if (s->freeCurve < 0 && s->count == s->capacity) {
+        int capacity = s->capacity ? s->capacity * 2 : 64;
+        sceneCurve *curves = (sceneCurve *) realloc(s->curves, sizeof (sceneCurve) * capacity);
+        if (!curves)
+            return -1;
+        s->curves = curves;
+        s->capacity = capacity;
+    }
+    if (s->noOfCurves == s->grid.largeCapacity) {
+        int capacity = s->grid.largeCapacity ? s->grid.largeCapacity * 2 : 64;
+        int *large = (int *) realloc(s->grid.large, sizeof (int) * capacity);
+        if (!large)
+            return -1;
+        s->grid.large = large;
+        s->grid.largeCapacity = capacity;
+    }
+    i = s->freeCurve >= 0 ? s->freeCurve : s->count;
+    c = s->curves + i;
+    next = c->next;
+    memset(c, 0, sizeof (sceneCurve));
+    /* a slot that stays free keeps its place in the free list */
+    c->next = next;
+    if (!(c->ctrl = poolAlloc(&s->pool, n, &c->ctrlCapacity)))
+        return -1;
+    memcpy(c->ctrl, ctrl, sizeof (vertex) * n);
+    c->n = n;
+    c->shown = -1;
+    curveBounds(s, c);
+    gridInsert(s, i);
+    if (i == s->freeCurve)
+        s->freeCurve = next;
+    else
+        s->count++;
+    c->used = true;
+    c->next = -1;
+    s->noOfCurves++;
+    return i;
+}
+
+void
+sceneRemove(scene *s, int i) {
+    sceneCurve *c = s->curves + i;
+    int t;
+
+    gridRemove(s, i);
+    poolRelease(&s->pool, c->ctrl, c->ctrlCapacity);
+    for (t = 0; t < SCENE_TIERS; t++) {
+        poolRelease(&s->pool, c->tiers[t].v, c->tiers[t].capacity);
+        c->tiers[t].v = NULL;
+    }
+    c->ctrl = NULL;
+    c->used = false;
+    c->next = s->freeCurve;
+    s->freeCurve = i;
+    s->noOfCurves--;
+    if (i == s->splineCurve)
+        s->splineCurve = -1;
+}
+
+int
+sceneAppend(scene *s, int i, double x, double y) {
+    sceneCurve *c = s->curves + i;
+
+    if (c->n == c->ctrlCapacity) {
+        int capacity;
+        vertex *ctrl = poolAlloc(&s->pool, c->n + 1, &capacity);
+        if (!ctrl)
+            return -1;
+        memcpy(ctrl, c->ctrl, sizeof (vertex) * c->n);
+        poolRelease(&s->pool, c->ctrl, c->ctrlCapacity);
+        c->ctrl = ctrl;
+        c->ctrlCapacity = capacity;
+    }
+    c->ctrl[c->n].x = x;
+    c->ctrl[c->n].y = y;
+    c->n++;
+    curveChanged(s, i, c->n - 1);
+    return 0;
+}
+
+void
+sceneMove(scene *s, int i, int k, double x, double y) {
+    s->curves[i].ctrl[k].x = x;
+    s->curves[i].ctrl[k].y = y;
+    curveChanged(s, i, k);
+}
+
+static int
+levelOf(double tolerance) {
+    int level = ilogb(tolerance);
+    return level < -64 ? -64 : level > 64 ? 64 : level;
+}
+
+double
+sceneLevelTolerance(double tolerance) {
+    return ldexp(1, levelOf(tolerance));
+}
+
+/* The tier to hold level: a stale one if any, else the one furthest from it. */
+static int
+tierFor(const sceneCurve *c, int level) {
+    int t, best = 0;
+
+    for (t = 0; t < SCENE_TIERS; t++) {
+        if (!c->tiers[t].valid)
+            return t;
+        if (abs(c->tiers[t].level - level) > abs(c->tiers[best].level - level))
+            best = t;
+    }
+    return best;
+}
+
+static int
+setTier(scene *s, int i, const polyline *pl, int level) {
+    sceneCurve *c = s->curves + i;
+    sceneTier *t = c->tiers + tierFor(c, level);
+
+    if (pl->count > t->capacity || !t->v) {
+        int capacity;
+        vertex *v = poolAlloc(&s->pool, pl->count, &capacity);
+        if (!v)
+            return -1;
+        poolRelease(&s->pool, t->v, t->capacity);
+        t->v = v;
+        t->capacity = capacity;
+    }
+    memcpy(t->v, pl->v, sizeof (vertex) * pl->count);
+    t->count = pl->count;
+    t->level = level;
+    t->valid = true;
+    c->shown = t - c->tiers;
+    return 0;
+}
+
+const sceneTier *
+sceneShown(const scene *s, int i) {
+    return s->curves[i].shown >= 0 ? s->curves[i].tiers + s->curves[i].shown : NULL;
+}
+
+int
+sceneSetPolyline(scene *s, int i, const polyline *pl, double tolerance) {
+    int level = levelOf(tolerance);
+    return setTier(s, i, pl, ldexp(1, level) < tolerance ? level + 1 : level);
+}
+
+int
+scenePolyline(scene *s, int i, double tolerance) {
+    sceneCurve *c = s->curves + i;
+    int level = levelOf(tolerance), t;
+
+    for (t = 0; t < SCENE_TIERS; t++)
+        if (c->tiers[t].valid && c->tiers[t].level == level) {
+            c->shown = t;
+            return 0;
+        }
+    if (i != s->splineCurve) {
+        splineInvalidate(&s->spline, -1);
+        s->splineCurve = i;
+    }
+    if (splinePolyline(&s->spline, c->ctrl, c->n, ldexp(1, level), &s->scratch) < 0)
+        return -1;
+    return setTier(s, i, &s->scratch, level);
+}
+
+int
+sceneQuery(scene *s, double x0, double y0, double x1, double y1, const int **found) {
+    sceneGrid *g = &s->grid;
+    sceneCurve *c;
+    int cx0 = cellOf(g->cell, x0), cy0 = cellOf(g->cell, y0), cx1 = cellOf(g->cell, x1), cy1 = cellOf(g->cell, y1);
+    int cx, cy, i, j, count = 0;
+
+    *found = s->found;
+    if (s->foundCapacity < s->count) {
+        int *p = (int *) realloc(s->found, sizeof (int) * s->capacity);
+        if (!p)
+            return 0;
+        *found = s->found = p;
+        s->foundCapacity = s->capacity;
+    }
+    if (s->stamp == INT_MAX) {
+        for (i = 0; i < s->count; i++)
+            s->curves[i].stamp = 0;
+        s->stamp = 0;
+    }
+    s->stamp++;
+
+    /* a view wider than the scene is cheaper to go through curve by curve */
+    if (((double) cx1 - cx0 + 1) * ((double) cy1 - cy0 + 1) > s->noOfCurves) {
+        for (i = 0; i < s->count; i++) {
+            c = s->curves + i;
+            if (c->used && c->maxX >= x0 && c->minX <= x1 && c->maxY >= y0 && c->minY <= y1)
+                s->found[count++] = i;
+        }
+        return count;
+    }
+    for (cx = cx0; cx <= cx1; cx++)
+        for (cy = cy0; cy <= cy1 && g->noOfBuckets; cy++)
+            for (j = g->buckets[hashCell(cx, cy, g->noOfBuckets)]; j >= 0; j = g->entries[j].next) {
+                if (g->entries[j].cx != cx || g->entries[j].cy != cy)
+                    continue;
+                c = s->curves + g->entries[j].curve;
+                if (c->stamp != s->stamp && c->maxX >= x0 && c->minX <= x1 && c->maxY >= y0 && c->minY <= y1) {
+                    c->stamp = s->stamp;
+                    s->found[count++] = g->entries[j].curve;
+                }
+            }
+    for (j = 0; j < g->noOfLarge; j++) {
+        c = s->curves + g->large[j];
+        if (c->maxX >= x0 && c->minX <= x1 && c->maxY >= y0 && c->minY <= y1)
+            s->found[count++] = g->large[j];
+    }
+    return count;
+}
+
+int
+scenePick(scene *s, double x, double y, double radius, int *k) {
+    const int *found;
+    int count = sceneQuery(s, x - radius, y - radius, x + radius, y + radius, &found), i, j, best = -1;
+    double bestDistance = radius * radius, dx, dy;
+
+    for (i = 0; i < count; i++) {
+        const sceneCurve *c = s->curves + found[i];
+        for (j = 0; j < c->n; j++) {
+            dx = c->ctrl[j].x - x;
+            dy = c->ctrl[j].y - y;
+            if (dx * dx + dy * dy <= bestDistance) {
+                bestDistance = dx * dx + dy * dy;
+                best = found[i];
+                *k = j;
+            }
+        }
+    }
+    return best;
+}
+
+bool
+sceneBounds(const scene *s, double *minX, double *minY, double *maxX, double *maxY) {
+    bool any = false;
+    int i;
+
+    for (i = 0; i < s->count; i++) {
+        const sceneCurve *c = s->curves + i;
+        if (!c->used)
+            continue;
+        *minX = !any || c->minX < *minX ? c->minX : *minX;
+        *minY = !any || c->minY < *minY ? c->minY : *minY;
+        *maxX = !any || c->maxX > *maxX ? c->maxX : *maxX;
+        *maxY = !any || c->maxY > *maxY ? c->maxY : *maxY;
+        any = true;
+    }
+    return any;
+}
+
+void
+sceneReindex(scene *s) {
+    double extent = 0;
+    int i;
+
+    for (i = 0; i < s->count; i++)
+        if (s->curves[i].used)
+            extent += fmax(s->curves[i].maxX - s->curves[i].minX, s->curves[i].maxY - s->curves[i].minY);
+    if (s->noOfCurves && extent > 0)
+        gridRebuild(s, 2 * extent / s->noOfCurves);
+}
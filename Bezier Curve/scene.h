@@ -0,0 +1,167 @@
+/*
+ * File:   scene.h
+ * Author: dibyendu
+ *
+ * Many curves held at once, in world coordinates. Control points and
+ * flattened polylines live in a pooled allocator, every curve caches its
+ * bounding box and polylines for the last few levels of detail it was
+ * shown at, and the boxes are kept in a uniform grid so that drawing a
+ * viewport or picking a point only looks at the curves near it. Like
+ * curve.h, nothing in here talks to the X server.
+ */
+
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "curve.h"
+
+#define POOL_CLASSES 28
+
+/*
+ * Blocks of 4 << k vertices for class k, carved from large slabs and kept
+ * on a free list per class once released, so curves that grow and shrink
+ * while they are edited settle into reusing the same few blocks.
+ */
+typedef struct {
+    vertex *free[POOL_CLASSES];
+    vertex **slabs, *next;
+    int noOfSlabs, slabCapacity, left;
+} vertexPool;
+
+void poolInit(vertexPool *p);
+void poolFree(vertexPool *p);
+
+/* A block of at least count vertices, its real size in capacity; NULL if out of memory. */
+vertex *poolAlloc(vertexPool *p, int count, int *capacity);
+void poolRelease(vertexPool *p, vertex *v, int capacity);
+
+/*
+ * Polylines come in levels of detail: one of level L is flattened to
+ * within 2^L world units of the curve, so zooming only reflattens a
+ * curve each time the scale doubles or halves, and zooming back finds
+ * the old level still there.
+ */
+#define SCENE_TIERS 3
+
+typedef struct {
+    vertex *v;
+    int count, capacity, level;
+    bool valid;
+} sceneTier;
+
+/*
+ * tiers hold the levels the curve was last shown at, shown indexes the
+ * latest (-1 if none); editing the curve stales all of them. The box
+ * covers the control points and the curve. Unused slots chain through
+ * next.
+ */
+typedef struct {
+    vertex *ctrl;
+    int n, ctrlCapacity;
+    sceneTier tiers[SCENE_TIERS];
+    int shown;
+    double minX, minY, maxX, maxY;
+    int cx0, cy0, cx1, cy1;
+    bool used, large;
+    int stamp, next;
+} sceneCurve;
+
+/* One cell a curve's box touches, chained per hash bucket. */
+typedef struct {
+    int curve, cx, cy, next;
+} gridEntry;
+
+/*
+ * Curves whose boxes would span more than GRID_MAX_CELLS cells go on the
+ * large list instead, which every query looks through. So does a curve
+ * whose cells could not be allocated; the list keeps room for every curve,
+ * so a curve is always in one or the other.
+ */
+#define GRID_MAX_CELLS 64
+
+typedef struct {
+    double cell;
+    int *buckets, noOfBuckets;
+    gridEntry *entries;
+    int noOfEntries, entryCapacity, freeEntry;
+    int *large, noOfLarge, largeCapacity;
+} sceneGrid;
+
+/*
+ * splineCache belongs to whichever curve was flattened last, usually the
+ * one being edited, so dragging its points only reflattens the segments
+ * that use them.
+ */
+typedef struct {
+    curveMode mode;
+    vertexPool pool;
+    sceneCurve *curves;
+    int count, capacity, freeCurve, noOfCurves;
+    sceneGrid grid;
+    splineCache spline;
+    int splineCurve;
+    polyline scratch;
+    int *found, foundCapacity, stamp;
+} scene;
+
+/* cell is the side of a grid cell in world units. */
+void sceneInit(scene *s, curveMode mode, double cell);
+void sceneFree(scene *s);
+void sceneClear(scene *s);
+
+/* Switches every curve to another mode, which stales all the polylines. */
+void sceneSetMode(scene *s, curveMode mode);
+
+/* Adds a curve of n > 0 control points; returns its index or -1. */
+int sceneAdd(scene *s, const vertex *ctrl, int n);
+void sceneRemove(scene *s, int i);
+
+/* Appends a control point to curve i; returns -1 if out of memory. */
+int sceneAppend(scene *s, int i, double x, double y);
+
+/* Moves control point k of curve i. */
+void sceneMove(scene *s, int i, int k, double x, double y);
+
+/* Tolerance of the level of detail that a tolerance asks for, a power of two no larger. */
+double sceneLevelTolerance(double tolerance);
+
+/*
+ * Makes the polyline of curve i at the level tolerance asks for the
+ * shown one, flattening it first unless a tier has it already; that
+ * takes the place of the tier furthest from it in level. Returns -1 if
+ * out of memory.
+ */
+int scenePolyline(scene *s, int i, double tolerance);
+
+/* The shown polyline of curve i, NULL if it has none since it last changed. */
+const sceneTier *sceneShown(const scene *s, int i);
+
+/*
+ * Installs a polyline flattened elsewhere to within tolerance as the
+ * shown one of curve i, at the level of the first power of two not below
+ * tolerance.
+ */
+int sceneSetPolyline(scene *s, int i, const polyline *pl, double tolerance);
+
+/*
+ * The curves whose boxes meet the rectangle, in found. Returns how many,
+ * valid until the next query.
+ */
+int sceneQuery(scene *s, double x0, double y0, double x1, double y1, const int **found);
+
+/*
+ * The control point nearest (x, y) within radius, as the curve index with
+ * the point in *k, or -1.
+ */
+int scenePick(scene *s, double x, double y, double radius, int *k);
+
+/* Box of every curve; false if the scene is empty. */
+bool sceneBounds(const scene *s, double *minX, double *minY, double *maxX, double *maxY);
+
+/*
+ * Rebuilds the grid with cells about twice the size of an average curve,
+ * after a load has put in curves of a scale the grid was not made for.
+ */
+void sceneReindex(scene *s);
+
+#endif
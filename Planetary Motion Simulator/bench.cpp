@@ -0,0 +1,125 @@
+/*
+ * File:   bench.cpp
+ * Author: dibyendu
+ *
+ * Benchmark of the simulation kernels on generated input: for a sweep of
+ * body counts, the closed form Kepler propagation, the Barnes-Hut gravity
+ * step and the snapshot hand-off to the render thread, each reporting
+ * throughput and latency percentiles. The bodies are the eight planets and
+ * an asteroid belt made of the rest, the same from run to run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "bodies.h"
+#include "nbody.h"
+#include "snapshot.h"
+#include "trace.h"
+
+const int sweep[] = {1000, 10000, 100000, 1000000},
+          noOfSweeps = sizeof (sweep) / sizeof (sweep[0]),
+          maxGravityBodies = 100000;
+
+const double centreX = 512, centreY = 384, sunX = 472, sunY = 384, stepTicks = 0.25;
+
+double
+uniform(unsigned int *seed) {
+    return (double) rand_r(seed) / RAND_MAX;
+}
+
+/* The planets and count - 8 belt asteroids, as the belt line of solar.cat makes them. */
+int
+generateBodies(bodySet *b, int count) {
+    unsigned int seed = 1;
+    double a;
+
+    bodySetInit(b);
+    bodySetAddPlanets(b);
+    while (b->count < count) {
+        a = 2 + 0.6 * uniform(&seed);
+        if (bodySetAdd(b, NULL, "#8C7853", 0.1, 0.5 * pow(a / 2, -1.5), a, a * 0.9, 0.15 * uniform(&seed),
+                360 * uniform(&seed), -1, false) < 0)
+            return -1;
+    }
+    bodySetPropagate(b, 0, centreX, centreY);
+    return 0;
+}
+
+/* Runs at least three times, then for as long as the time allows. */
+#define REPEAT(i, budget, first) \
+    for (i = 0, first = traceNow(); i < 3 || (i < 100000 && traceNow() - first < (budget)); i++)
+
+int
+main(int argc, char **argv) {
+    static char names[3][sizeof (sweep) / sizeof (sweep[0])][32];
+    tracer trace;
+    bodySet b;
+    nbodySystem s;
+    tripleBuffer frames;
+    snapshot *back;
+    double scale = 1, start, first;
+    int threads = 0, i, k, n;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-threads") && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-scale") && i + 1 < argc && atof(argv[i + 1]) > 0)
+            scale = atof(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [-threads <count>] [-scale <factor>]\n", argv[0]);
+            return (EXIT_FAILURE);
+        }
+    }
+    if (!threads)
+        threads = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+
+    traceInit(&trace);
+    for (k = 0; k < noOfSweeps; k++) {
+        n = sweep[k];
+        if (generateBodies(&b, n) < 0) {
+            fprintf(stderr, "%s: out of memory for %d bodies\n", argv[0], n);
+            return (EXIT_FAILURE);
+        }
+
+        sprintf(names[0][k], "propagate %d", n);
+        REPEAT(i, 0.3 * scale, first) {
+            start = traceNow();
+            bodySetPropagate(&b, i * stepTicks, centreX, centreY);
+            traceRecord(&trace, names[0][k], 0, start, traceNow(), -1);
+        }
+
+        sprintf(names[1][k], "snapshot %d", n);
+        tripleBufferInit(&frames);
+        REPEAT(i, 0.3 * scale, first) {
+            start = traceNow();
+            if (!(back = tripleBufferBack(&frames, n)))
+                break;
+            memcpy(back->x, b.x, sizeof (double) * n);
+            memcpy(back->y, b.y, sizeof (double) * n);
+            tripleBufferPublish(&frames);
+            tripleBufferFront(&frames);
+            traceRecord(&trace, names[1][k], 0, start, traceNow(), -1);
+        }
+        tripleBufferFree(&frames);
+
+        /* the first step builds the tree arena, so it is left out */
+        sprintf(names[2][k], "gravity %d x%d", n, threads);
+        if (n <= maxGravityBodies && nbodyInit(&s, sunX, sunY, threads) == 0 && nbodySeed(&s, &b) == 0) {
+            nbodyStep(&s, stepTicks);
+            REPEAT(i, 1.0 * scale, first) {
+                start = traceNow();
+                nbodyStep(&s, stepTicks);
+                traceRecord(&trace, names[2][k], 0, start, traceNow(), -1);
+            }
+            nbodyFree(&s);
+        }
+        bodySetFree(&b);
+    }
+    traceSummary(&trace, stdout);
+    traceFree(&trace);
+    return (EXIT_SUCCESS);
+}
@@ -0,0 +1,261 @@
+/*
+ * File:   bodies.cpp
+ * Author: dibyendu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include "bodies.h"
+
+/*
+ * Mercury  Venus  Earth  Mars  Jupiter  Saturn  Uranus  Neptune
+ */
+const double planetData[] = {0.6, 0.9, 1, 0.7, 5.4, 4.4, 2.6, 1.6,
+    2, 1.5, 1, 0.8, 0.72, 0.65, 0.58, 0.51,
+    0.6, 0.8, 1, 1.5, 3, 4.4, 6, 8,
+    0.4, 0.6, 0.8, 1.3, 2.8, 4.2, 5.8, 7.8,
+    0.2056, 0.0068, 0.0167, 0.0934, 0.0483, 0.0560, 0.0461, 0.0097};
+
+const char *planetName[] = {"Mercury", "Venus", "Earth", "Mars", "Jupiter", "Saturn", "Uranus", "Neptune"},
+           *planetColour[] = {"#0000FF", "#229942", "#3594BB", "#A52828", "#C14B4B",
+                              "#62BFED", "#4CBA8B", "#AD6E4A"};
+
+typedef double v4d __attribute__ ((vector_size(4 * sizeof (double))));
+
+void
+bodySetInit(bodySet *b) {
+    memset(b, 0, sizeof (bodySet));
+}
+
+void
+bodySetFree(bodySet *b) {
+    int i;
+    free(b->semiMajor);
+    free(b->semiMinor);
+    free(b->eccentricity);
+    free(b->meanMotion);
+    free(b->phase);
+    free(b->radius);
+    free(b->x);
+    free(b->y);
+    free(b->parent);
+    free(b->colour);
+    free(b->orbit);
+    for (i = 0; i < b->count; i++)
+        free(b->name[i]);
+    free(b->name);
+    free(b->moons);
+    for (i = 0; i < b->noOfColours; i++)
+        free((char *) b->colours[i]);
+    bodySetInit(b);
+}
+
+static bool
+grow(void **field, size_t size, int oldCapacity, int capacity) {
+    void *p = realloc(*field, size * capacity);
+    if (!p)
+        return false;
+    memset((char *) p + size * oldCapacity, 0, size * (capacity - oldCapacity));
+    *field = p;
+    return true;
+}
+
+static bool
+reserve(bodySet *b, int count) {
+    int capacity = b->capacity ? b->capacity : 16;
+    if (count > INT_MAX / 2 - 4)
+        return false;
+    if (count + 4 <= b->capacity)
+        return true;
+    while (capacity < count + 4)
+        capacity *= 2;
+    if (!grow((void **) &b->semiMajor, sizeof (double), b->capacity, capacity)
+            || !grow((void **) &b->semiMinor, sizeof (double), b->capacity, capacity)
+            || !grow((void **) &b->eccentricity, sizeof (double), b->capacity, capacity)
+            || !grow((void **) &b->meanMotion, sizeof (double), b->capacity, capacity)
+            || !grow((void **) &b->phase, sizeof (double), b->capacity, capacity)
+            || !grow((void **) &b->radius, sizeof (double), b->capacity, capacity)
+            || !grow((void **) &b->x, sizeof (double), b->capacity, capacity)
+            || !grow((void **) &b->y, sizeof (double), b->capacity, capacity)
+            || !grow((void **) &b->parent, sizeof (int), b->capacity, capacity)
+            || !grow((void **) &b->colour, sizeof (unsigned char), b->capacity, capacity)
+            || !grow((void **) &b->orbit, sizeof (bool), b->capacity, capacity)
+            || !grow((void **) &b->name, sizeof (char *), b->capacity, capacity)
+            || !grow((void **) &b->moons, sizeof (int), b->capacity, capacity))
+        return false;
+    b->capacity = capacity;
+    return true;
+}
+
+int
+bodySetReserve(bodySet *b, int count) {
+    return reserve(b, count) ? 0 : -1;
+}
+
+int
+bodySetColour(bodySet *b, const char *colour) {
+    int i;
+    for (i = 0; i < b->noOfColours; i++)
+        if (!strcmp(b->colours[i], colour))
+            return i;
+    if (b->noOfColours == MAX_COLOURS)
+        return MAX_COLOURS - 1;
+    b->colours[b->noOfColours] = strdup(colour);
+    return b->noOfColours++;
+}
+
+bool
+bodyElementsValid(double semiMajor, double semiMinor, double eccentricity) {
+    return semiMajor > 0 && semiMinor > 0 && eccentricity >= 0 && eccentricity < 1;
+}
+
+int
+bodySetAdd(bodySet *b, const char *name, const char *colour, double radius, double angVelocity,
+        double semiMajor, double semiMinor, double eccentricity, double phaseInDegrees, int parent, bool orbit) {
+    int i = b->count;
+    if (!reserve(b, i + 1))
+        return -1;
+    b->radius[i] = radius * earthRadius;
+    b->meanMotion[i] = angVelocity * earthAngularVelocity * M_PI / 180;
+    b->semiMajor[i] = semiMajor * earthOrbitSemiMajor;
+    b->semiMinor[i] = semiMinor * earthOrbitSemiMinor;
+    b->eccentricity[i] = eccentricity;
+    b->phase[i] = phaseInDegrees * M_PI / 180;
+    b->parent[i] = parent;
+    b->colour[i] = bodySetColour(b, colour);
+    b->orbit[i] = orbit;
+    b->name[i] = name ? strdup(name) : NULL;
+    if (parent >= 0)
+        b->moons[b->noOfMoons++] = i;
+    return b->count++;
+}
+
+void
+bodySetAddPlanets(bodySet *b) {
+    for (int i = 0; i < 8; i++)   // venus & uranus rotate clockwise
+        bodySetAdd(b, planetName[i], planetColour[i], planetData[i], planetData[i + 8] * (i == 1 || i == 6 ? -1 : 1),
+                planetData[i + 16], planetData[i + 24], planetData[i + 32], 90 * i, -1, true);
+    return;
+}
+
+static double
+uniform(unsigned long long *seed) {
+    *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (*seed >> 11) * (1.0 / 9007199254740992.0);
+}
+
+int
+bodySetLoad(bodySet *b, const char *path) {
+    FILE *f = fopen(path, "r");
+    char line[512], kind[16], name[64], colour[32], parentName[64];
+    double radius, angVelocity, semiMajor, semiMinor, eccentricity, phase, outer;
+    unsigned long long seed = 2010;
+    int lineNo = 0, count, fields, parent, i;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof (line), f)) {
+        char *hash = strchr(line, '#');
+        lineNo++;
+        /* colours start with '#' too, so only a leading one is a comment */
+        if (hash && strspn(line, " \t") == (size_t) (hash - line))
+            continue;
+        if (sscanf(line, "%15s", kind) != 1)
+            continue;
+        phase = 0;
+        if (!strcmp(kind, "body")) {
+            fields = sscanf(line, "%*s %63s %31s %lf %lf %lf %lf %lf %lf", name, colour, &radius, &angVelocity,
+                    &semiMajor, &semiMinor, &eccentricity, &phase);
+            if (fields >= 7 && bodyElementsValid(semiMajor, semiMinor, eccentricity)
+                    && bodySetAdd(b, name, colour, radius, angVelocity, semiMajor, semiMinor, eccentricity, phase, -1,
+                    true) >= 0)
+                continue;
+        } else if (!strcmp(kind, "moon")) {
+            fields = sscanf(line, "%*s %63s %31s %63s %lf %lf %lf %lf %lf %lf", name, colour, parentName, &radius,
+                    &angVelocity, &semiMajor, &semiMinor, &eccentricity, &phase);
+            for (parent = b->count - 1; parent >= 0; parent--)
+                if (b->name[parent] && !strcmp(b->name[parent], parentName))
+                    break;
+            if (fields >= 8 && parent >= 0 && bodyElementsValid(semiMajor, semiMinor, eccentricity)
+                    && bodySetAdd(b, name, colour, radius, angVelocity, semiMajor, semiMinor, eccentricity, phase,
+                    parent, false) >= 0)
+                continue;
+        } else if (!strcmp(kind, "belt")) {
+            fields = sscanf(line, "%*s %63s %31s %d %lf %lf %lf %lf %lf %lf", name, colour, &count, &radius,
+                    &angVelocity, &semiMajor, &outer, &semiMinor, &eccentricity);
+            if (fields == 9 && count >= 0 && count <= INT_MAX / 2 - b->count && outer > 0
+                    && bodyElementsValid(semiMajor, semiMinor, eccentricity) && reserve(b, b->count + count)) {
+                for (i = 0; i < count; i++) {
+                    double a = semiMajor + (outer - semiMajor) * uniform(&seed);
+                    bodySetAdd(b, NULL, colour, radius, angVelocity * pow(a / semiMajor, -1.5), a, a * semiMinor,
+                            eccentricity * uniform(&seed), 360 * uniform(&seed), -1, false);
+                }
+                continue;
+            }
+        }
+        fprintf(stderr, "%s:%d: can not read: %s", path, lineNo, line);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return 0;
+}
+
+/*
+ * Sine and cosine of x, within a little of [-pi, pi], through the half angle,
+ * whose Taylor series converge to well below a thousandth of a pixel there.
+ */
+static inline void
+sinCos4(const v4d &x, v4d *s, v4d *c) {
+    v4d h = x * 0.5, h2 = h * h, sh, ch;
+    sh = h * (1 - h2 * (1.0 / 6) * (1 - h2 * (1.0 / 20) * (1 - h2 * (1.0 / 42) * (1 - h2 * (1.0 / 72)
+            * (1 - h2 * (1.0 / 110) * (1 - h2 * (1.0 / 156)))))));
+    ch = 1 - h2 * 0.5 * (1 - h2 * (1.0 / 12) * (1 - h2 * (1.0 / 30) * (1 - h2 * (1.0 / 56)
+            * (1 - h2 * (1.0 / 90) * (1 - h2 * (1.0 / 132))))));
+    *s = 2 * sh * ch;
+    *c = 1 - 2 * sh * sh;
+}
+
+void
+bodySetPropagate(bodySet *b, double ticks, double cx, double cy) {
+    const double roundingBias = 6755399441055744.0;     // 1.5 * 2^52
+    v4d m, e, E, s, c, a, bAxis;
+    int i, k;
+
+    for (i = 0; i < b->count; i += 4) {
+        memcpy(&m, b->meanMotion + i, sizeof (v4d));
+        memcpy(&s, b->phase + i, sizeof (v4d));
+        memcpy(&e, b->eccentricity + i, sizeof (v4d));
+        memcpy(&a, b->semiMajor + i, sizeof (v4d));
+        memcpy(&bAxis, b->semiMinor + i, sizeof (v4d));
+
+        /* mean anomaly, reduced to [-pi, pi] */
+        m = s + m * ticks;
+        m -= 2 * M_PI * ((m * (0.5 / M_PI) + roundingBias) - roundingBias);
+
+        sinCos4(m, &s, &c);
+        E = m + e * s;
+        for (k = 0; k < 3; k++) {
+            sinCos4(E, &s, &c);
+            E -= (E - e * s - m) / (1 - e * c);
+        }
+        sinCos4(E, &s, &c);
+
+        /* periapsis, where E = 0 and the body is fastest, faces the sun left of the centre */
+        s = cy + bAxis * s;
+        c = cx - a * c;
+        memcpy(b->x + i, &c, sizeof (v4d));
+        memcpy(b->y + i, &s, sizeof (v4d));
+    }
+    for (k = 0; k < b->noOfMoons; k++) {
+        i = b->moons[k];
+        b->x[i] += b->x[b->parent[i]] - cx;
+        b->y[i] += b->y[b->parent[i]] - cy;
+    }
+    return;
+}
@@ -0,0 +1,85 @@
+/*
+ * File:   bodies.h
+ * Author: dibyendu
+ *
+ * The bodies of the simulation (planets, moons, asteroids) kept as a
+ * structure of arrays so that their positions can be computed in batches.
+ */
+
+#ifndef BODIES_H
+#define BODIES_H
+
+#define MAX_COLOURS 32
+
+const double earthRadius = 6,
+             earthOrbitSemiMajor = 60,
+             earthOrbitSemiMinor = 40,
+             earthAngularVelocity = 2;
+
+/*
+ * Orbital elements are in pixels and radians per tick; positions are filled
+ * in by bodySetPropagate. Arrays are padded to a multiple of four entries
+ * (with zero sized orbits) so the kernel never needs a scalar tail.
+ */
+typedef struct {
+    int count, capacity;
+    double *semiMajor, *semiMinor, *eccentricity, *meanMotion, *phase, *radius;
+    double *x, *y;
+    int *parent;
+    unsigned char *colour;
+    bool *orbit;
+    char **name;
+    int *moons, noOfMoons;
+    const char *colours[MAX_COLOURS];
+    int noOfColours;
+} bodySet;
+
+void bodySetInit(bodySet *b);
+void bodySetFree(bodySet *b);
+
+/*
+ * Adds a body given in the units of planetData, i.e. relative to the earth;
+ * angVelocity is in degrees per tick, negative for clockwise orbits, and
+ * parent is the index of the body it circles or -1 for the sun.
+ * Returns its index or -1.
+ */
+int bodySetAdd(bodySet *b, const char *name, const char *colour, double radius, double angVelocity,
+        double semiMajor, double semiMinor, double eccentricity, double phaseInDegrees, int parent, bool orbit);
+
+/* Whether the elements describe an ellipse: both axes positive and 0 <= e < 1. */
+bool bodyElementsValid(double semiMajor, double semiMinor, double eccentricity);
+
+/* Makes room for count bodies in all; returns -1 if out of memory. */
+int bodySetReserve(bodySet *b, int count);
+
+/*
+ * Index of a colour in the palette, adding it if it is new; once the
+ * palette is full the last entry stands in for any further colours.
+ */
+int bodySetColour(bodySet *b, const char *colour);
+
+/* The eight planets of planetData. */
+void bodySetAddPlanets(bodySet *b);
+
+/*
+ * Reads a catalog, one body per line:
+ *   body <name> <colour> <radius> <angVelocity> <semiMajor> <semiMinor> <eccentricity> [<phase>]
+ *   moon <name> <colour> <parent> <radius> <angVelocity> <semiMajor> <semiMinor> <eccentricity> [<phase>]
+ *   belt <name> <colour> <count> <radius> <angVelocity> <innerSemiMajor> <outerSemiMajor> <axisRatio> <maxEccentricity>
+ * Belt members get random phases and elements, with angVelocity given at
+ * the inner edge and falling off as a^-1.5 outwards. '#' starts a comment.
+ * Returns -1 after printing the offending line, which includes any whose
+ * elements bodyElementsValid rejects.
+ */
+int bodySetLoad(bodySet *b, const char *path);
+
+/*
+ * Positions of every body at the given time in ticks, on ellipses around
+ * the centre (cx, cy) with periapsis on the left, towards the sun (and
+ * likewise for moons around their parents): mean anomalies are advanced
+ * in closed form and Kepler's equation solved with a few Newton steps,
+ * four bodies per vector instruction with polynomial sine and cosine.
+ */
+void bodySetPropagate(bodySet *b, double ticks, double cx, double cy);
+
+#endif
@@ -0,0 +1,210 @@
+/*
+ * File:   checkpoint.cpp
+ * Author: dibyendu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "checkpoint.h"
+
+#define BODY_DOUBLES 6
+#define SYSTEM_DOUBLES 7
+
+static size_t
+fileSize(int count, bool gravity) {
+    return sizeof (checkpointHeader) + sizeof (double) * count * (BODY_DOUBLES + (gravity ? SYSTEM_DOUBLES : 0))
+            + sizeof (int32_t) * count + 2 * count;
+}
+
+int
+checkpointSave(const char *path, const bodySet *b, const nbodySystem *s, double ticks) {
+    const double *doubles[BODY_DOUBLES + SYSTEM_DOUBLES] = {b->semiMajor, b->semiMinor, b->eccentricity, b->meanMotion,
+        b->phase, b->radius};
+    checkpointHeader *h;
+    char *p, *map, *temporary = (char *) malloc(strlen(path) + 5);
+    size_t size = fileSize(b->count, s), n = b->count;
+    int fd = -1, i, status = -1;
+
+    if (!temporary)
+        return -1;
+    sprintf(temporary, "%s.new", path);
+    /* blocks are reserved up front, so a full disk fails here rather than as SIGBUS in the stores below */
+    if ((fd = open(temporary, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0 || (errno = posix_fallocate(fd, 0, size)) != 0
+            || (map = (char *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+        perror(temporary);
+        goto done;
+    }
+
+    h = (checkpointHeader *) map;
+    memset(h, 0, sizeof (checkpointHeader));
+    memcpy(h->magic, CHECKPOINT_MAGIC, sizeof (h->magic));
+    h->count = b->count;
+    h->gravity = s != NULL;
+    h->ticks = ticks;
+    h->noOfColours = b->noOfColours;
+    for (i = 0; i < b->noOfColours; i++)
+        strncpy(h->colours[i], b->colours[i], sizeof (h->colours[i]) - 1);
+    if (s) {
+        h->primed = s->primed;
+        h->sunX = s->sunX;
+        h->sunY = s->sunY;
+        h->sunMass = s->sunMass;
+        doubles[BODY_DOUBLES] = s->x;
+        doubles[BODY_DOUBLES + 1] = s->y;
+        doubles[BODY_DOUBLES + 2] = s->vx;
+        doubles[BODY_DOUBLES + 3] = s->vy;
+        doubles[BODY_DOUBLES + 4] = s->ax;
+        doubles[BODY_DOUBLES + 5] = s->ay;
+        doubles[BODY_DOUBLES + 6] = s->mass;
+    }
+
+    p = map + sizeof (checkpointHeader);
+    for (i = 0; i < BODY_DOUBLES + (s ? SYSTEM_DOUBLES : 0); i++, p += sizeof (double) * n)
+        memcpy(p, doubles[i], sizeof (double) * n);
+    for (i = 0; i < (int) n; i++, p += sizeof (int32_t))
+        *(int32_t *) p = b->parent[i];
+    memcpy(p, b->colour, n);
+    for (i = 0, p += n; i < (int) n; i++)
+        p[i] = b->orbit[i];
+
+    /* the old checkpoint stays until the new one has safely reached the disk */
+    if (msync(map, size, MS_SYNC) < 0 || rename(temporary, path) < 0)
+        perror(path);
+    else
+        status = 0;
+    munmap(map, size);
+done:
+    if (fd >= 0)
+        close(fd);
+    if (status < 0)
+        unlink(temporary);
+    free(temporary);
+    return status;
+}
+
+/* Maps path read only and checks its header; returns the mapping or NULL. */
+static const char *
+mapCheckpoint(const char *path, size_t *size) {
+    const checkpointHeader *h;
+    struct stat st;
+    char *map;
+    int fd = open(path, O_RDONLY), i;
+
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(path);
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+    *size = st.st_size;
+    map = *size >= sizeof (checkpointHeader) ? (char *) mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0) : (char *) MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "%s: not a checkpoint\n", path);
+        return NULL;
+    }
+    h = (const checkpointHeader *) map;
+    if (memcmp(h->magic, CHECKPOINT_MAGIC, sizeof (h->magic)) || h->count < 0 || h->noOfColours < 0
+            || h->noOfColours > MAX_COLOURS || *size != fileSize(h->count, h->gravity)) {
+        fprintf(stderr, "%s: not a checkpoint, or a truncated one\n", path);
+        munmap(map, *size);
+        return NULL;
+    }
+    for (i = 0; i < h->noOfColours; i++)
+        if (!memchr(h->colours[i], 0, sizeof (h->colours[i]))) {
+            fprintf(stderr, "%s: not a checkpoint\n", path);
+            munmap(map, *size);
+            return NULL;
+        }
+    return map;
+}
+
+int
+checkpointPeek(const char *path, checkpointHeader *h) {
+    size_t size;
+    const char *map = mapCheckpoint(path, &size);
+
+    if (!map)
+        return -1;
+    memcpy(h, map, sizeof (checkpointHeader));
+    munmap((void *) map, size);
+    return 0;
+}
+
+int
+checkpointLoad(const char *path, bodySet *b, nbodySystem *s, double *ticks) {
+    const checkpointHeader *h;
+    const double *d;
+    const char *map, *p;
+    size_t size, n;
+    int i, colour, status = -1;
+
+    if (!(map = mapCheckpoint(path, &size)))
+        return -1;
+    h = (const checkpointHeader *) map;
+    n = h->count;
+    if (h->gravity && !s) {
+        fprintf(stderr, "%s: a gravity mode checkpoint\n", path);
+        goto done;
+    }
+    for (i = 0; i < h->noOfColours; i++)
+        bodySetColour(b, h->colours[i]);
+    if (bodySetReserve(b, n) < 0)
+        goto nomemory;
+
+    d = (const double *) (map + sizeof (checkpointHeader));
+    memcpy(b->semiMajor, d, sizeof (double) * n);
+    memcpy(b->semiMinor, d + n, sizeof (double) * n);
+    memcpy(b->eccentricity, d + 2 * n, sizeof (double) * n);
+    memcpy(b->meanMotion, d + 3 * n, sizeof (double) * n);
+    memcpy(b->phase, d + 4 * n, sizeof (double) * n);
+    memcpy(b->radius, d + 5 * n, sizeof (double) * n);
+    p = (const char *) (d + (BODY_DOUBLES + (h->gravity ? SYSTEM_DOUBLES : 0)) * n);
+    for (i = 0; i < (int) n; i++) {
+        b->parent[i] = ((const int32_t *) p)[i];
+        /*
+         * moons come after their parents, as bodySetLoad makes them, and
+         * Kepler orbits must be ellipses; gravity only uses the elements
+         * for drawing, and bodies added by clicking have none
+         */
+        if (b->parent[i] < -1 || b->parent[i] >= i
+                || (!h->gravity && !bodyElementsValid(b->semiMajor[i], b->semiMinor[i], b->eccentricity[i]))) {
+            fprintf(stderr, "%s: not a checkpoint\n", path);
+            goto done;
+        }
+        colour = (unsigned char) p[sizeof (int32_t) * n + i];
+        b->colour[i] = colour < b->noOfColours ? colour : 0;
+        b->orbit[i] = p[(sizeof (int32_t) + 1) * n + i];
+        b->name[i] = NULL;
+        if (b->parent[i] >= 0)
+            b->moons[b->noOfMoons++] = i;
+    }
+    b->count = n;
+
+    if (h->gravity) {
+        d += BODY_DOUBLES * n;
+        s->sunX = h->sunX;
+        s->sunY = h->sunY;
+        s->sunMass = h->sunMass;
+        for (i = 0; i < (int) n; i++)
+            if (nbodyAdd(s, d[i], d[n + i], d[2 * n + i], d[3 * n + i], d[6 * n + i]) < 0)
+                goto nomemory;
+        memcpy(s->ax, d + 4 * n, sizeof (double) * n);
+        memcpy(s->ay, d + 5 * n, sizeof (double) * n);
+        s->primed = h->primed;
+    }
+    *ticks = h->ticks;
+    status = 0;
+    goto done;
+nomemory:
+    fprintf(stderr, "%s: out of memory for %d bodies\n", path, (int) n);
+done:
+    munmap((void *) map, size);
+    return status;
+}
@@ -0,0 +1,58 @@
+/*
+ * File:   checkpoint.h
+ * Author: dibyendu
+ *
+ * Binary checkpoints of a simulation: the time, every body's orbital
+ * elements and looks, and in gravity mode the state of the N-body system,
+ * so a long run can be picked up again exactly where it was left. Files
+ * are written and read through a memory mapping, so a million bodies go
+ * to and from the page cache without any per body I/O calls. The layout is
+ * native (byte order, double format) and meant for the machine that wrote
+ * it:
+ *
+ *   header      checkpointHeader
+ *   doubles     semiMajor, semiMinor, eccentricity, meanMotion, phase,
+ *               radius, then in gravity mode x, y, vx, vy, ax, ay, mass
+ *   int32       parent
+ *   bytes       colour, orbit
+ *
+ * each array count entries long.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include "bodies.h"
+#include "nbody.h"
+
+#define CHECKPOINT_MAGIC "PLANCKP1"
+
+typedef struct {
+    char magic[8];
+    int32_t count, gravity, primed, noOfColours;
+    double ticks, sunX, sunY, sunMass;
+    char colours[MAX_COLOURS][32];
+} checkpointHeader;
+
+/*
+ * Writes b at the given time, and s unless it is NULL, to path; the file
+ * is replaced only once the new one is complete. Returns -1 after printing
+ * what went wrong.
+ */
+int checkpointSave(const char *path, const bodySet *b, const nbodySystem *s, double ticks);
+
+/*
+ * Reads the header of path into h, checking that the file is complete, so
+ * the caller can set up for what it holds. Returns -1 after printing what
+ * went wrong.
+ */
+int checkpointPeek(const char *path, checkpointHeader *h);
+
+/*
+ * Fills the empty body set b, and in gravity mode the freshly initialised
+ * system s, from path; returns -1 after printing what went wrong.
+ */
+int checkpointLoad(const char *path, bodySet *b, nbodySystem *s, double *ticks);
+
+#endif
@@ -0,0 +1,470 @@
+/*
+ * File:   nbody.cpp
+ * Author: dibyendu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "nbody.h"
+
+#define LEAF_SIZE 8
+#define MAX_DEPTH 40
+#define FORCE_CHUNK 64
+
+/*
+ * A node is used as a whole when its side is below openingAngle times its
+ * distance; softening keeps close encounters finite. A body the size of
+ * the earth weighs earthMass suns, the rest scale with their volume.
+ */
+const double openingAngle = 0.8,
+             softening = 1,
+             earthMass = 3e-6;
+
+static bool
+grow(void **field, size_t size, int capacity) {
+    void *p = realloc(*field, size * capacity);
+    if (!p)
+        return false;
+    *field = p;
+    return true;
+}
+
+static inline bool
+listAppend(interactionList *l, double x, double y, double mass) {
+    if (l->count == l->capacity) {
+        int capacity = l->capacity ? l->capacity * 2 : 256;
+        if (!grow((void **) &l->x, sizeof (double), capacity)
+                || !grow((void **) &l->y, sizeof (double), capacity)
+                || !grow((void **) &l->mass, sizeof (double), capacity))
+            return false;
+        l->capacity = capacity;
+    }
+    l->x[l->count] = x;
+    l->y[l->count] = y;
+    l->mass[l->count++] = mass;
+    return true;
+}
+
+static void
+listFree(interactionList *l) {
+    free(l->x);
+    free(l->y);
+    free(l->mass);
+}
+
+static void *
+forceWorker(void *arg);
+
+int
+nbodyInit(nbodySystem *s, double sunX, double sunY, int threads) {
+    double meanMotion = earthAngularVelocity * M_PI / 180;
+    int i;
+
+    memset(s, 0, sizeof (nbodySystem));
+    s->sunX = sunX;
+    s->sunY = sunY;
+    /* Kepler's third law, so that the earth keeps its kinematic period */
+    s->sunMass = meanMotion * meanMotion * earthOrbitSemiMajor * earthOrbitSemiMajor * earthOrbitSemiMajor;
+    s->threads = 1;
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->start, NULL);
+    pthread_cond_init(&s->finished, NULL);
+
+    if (threads > 1 && !(s->workers = (pthread_t *) malloc(sizeof (pthread_t) * (threads - 1))))
+        return -1;
+    for (i = 1; i < threads; i++) {
+        if (pthread_create(s->workers + i - 1, NULL, forceWorker, s))
+            break;
+        s->threads++;
+    }
+    return 0;
+}
+
+void
+nbodyFree(nbodySystem *s) {
+    int i;
+
+    pthread_mutex_lock(&s->lock);
+    s->quit = true;
+    pthread_cond_broadcast(&s->start);
+    pthread_mutex_unlock(&s->lock);
+    for (i = 0; i < s->threads - 1; i++)
+        pthread_join(s->workers[i], NULL);
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->start);
+    pthread_cond_destroy(&s->finished);
+
+    free(s->workers);
+    free(s->x);
+    free(s->y);
+    free(s->px);
+    free(s->py);
+    free(s->vx);
+    free(s->vy);
+    free(s->ax);
+    free(s->ay);
+    free(s->mass);
+    free(s->next);
+    free(s->nodes);
+    free(s->leaves);
+    listFree(&s->list);
+    memset(s, 0, sizeof (nbodySystem));
+}
+
+int
+nbodyAdd(nbodySystem *s, double x, double y, double vx, double vy, double mass) {
+    int i = s->count;
+
+    if (i == s->capacity) {
+        int capacity = s->capacity ? s->capacity * 2 : 64;
+        if (!grow((void **) &s->x, sizeof (double), capacity)
+                || !grow((void **) &s->y, sizeof (double), capacity)
+                || !grow((void **) &s->px, sizeof (double), capacity)
+                || !grow((void **) &s->py, sizeof (double), capacity)
+                || !grow((void **) &s->vx, sizeof (double), capacity)
+                || !grow((void **) &s->vy, sizeof (double), capacity)
+                || !grow((void **) &s->ax, sizeof (double), capacity)
+                || !grow((void **) &s->ay, sizeof (double), capacity)
+                || !grow((void **) &s->mass, sizeof (double), capacity)
+                || !grow((void **) &s->next, sizeof (int), capacity))
+            return -1;
+        s->capacity = capacity;
+    }
+    s->x[i] = s->px[i] = x;
+    s->y[i] = s->py[i] = y;
+    s->vx[i] = vx;
+    s->vy[i] = vy;
+    s->ax[i] = s->ay[i] = 0;
+    s->mass[i] = mass;
+    s->primed = false;
+    return s->count++;
+}
+
+/* Velocity of a circular orbit at offset (dx, dy) from a mass; y grows downwards. */
+static void
+circularVelocity(double mass, double dx, double dy, bool clockwise, double *vx, double *vy) {
+    double r = sqrt(dx * dx + dy * dy), v;
+
+    if (r == 0) {
+        *vx = *vy = 0;
+        return;
+    }
+    v = sqrt(mass / r) / r * (clockwise ? -1 : 1);
+    *vx = dy * v;
+    *vy = -dx * v;
+}
+
+static double
+bodyMass(const nbodySystem *s, double radius) {
+    double r = radius / earthRadius;
+    return s->sunMass * earthMass * r * r * r;
+}
+
+int
+nbodyAddOrbiting(nbodySystem *s, double x, double y, double radius, bool clockwise) {
+    double vx, vy;
+    circularVelocity(s->sunMass, x - s->sunX, y - s->sunY, clockwise, &vx, &vy);
+    return nbodyAdd(s, x, y, vx, vy, bodyMass(s, radius));
+}
+
+int
+nbodySeed(nbodySystem *s, const bodySet *b) {
+    double vx, vy;
+    int i, p;
+
+    for (i = 0; i < b->count; i++) {
+        p = b->parent[i];
+        if (p < 0) {
+            if (nbodyAddOrbiting(s, b->x[i], b->y[i], b->radius[i], b->meanMotion[i] < 0) < 0)
+                return -1;
+            continue;
+        }
+        circularVelocity(s->mass[p], b->x[i] - b->x[p], b->y[i] - b->y[p], b->meanMotion[i] < 0, &vx, &vy);
+        if (nbodyAdd(s, b->x[i], b->y[i], s->vx[p] + vx, s->vy[p] + vy, bodyMass(s, b->radius[i])) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static inline int
+quadrant(const quadNode *n, double x, double y) {
+    return (x >= n->cx) | ((y >= n->cy) << 1);
+}
+
+static int
+split(nbodySystem *s, int parent) {
+    int first = s->noOfNodes, q;
+    quadNode *n;
+
+    if (first + 4 > s->nodeCapacity) {
+        int capacity = s->nodeCapacity ? s->nodeCapacity * 2 : 1024;
+        if (!grow((void **) &s->nodes, sizeof (quadNode), capacity))
+            return -1;
+        s->nodeCapacity = capacity;
+    }
+    s->noOfNodes += 4;
+    for (q = 0; q < 4; q++) {
+        n = s->nodes + first + q;
+        n->half = s->nodes[parent].half / 2;
+        n->cx = s->nodes[parent].cx + (q & 1 ? n->half : -n->half);
+        n->cy = s->nodes[parent].cy + (q & 2 ? n->half : -n->half);
+        n->parent = parent;
+        n->firstChild = n->body = -1;
+        n->count = 0;
+    }
+    return first;
+}
+
+static void
+push(nbodySystem *s, quadNode *n, int i) {
+    s->next[i] = n->body;
+    n->body = i;
+    n->count++;
+}
+
+/*
+ * Builds the tree in the node arena. Leaves take up to LEAF_SIZE bodies
+ * before they split, and any number once MAX_DEPTH is reached so that
+ * coincident bodies do not recurse forever.
+ */
+static int
+buildTree(nbodySystem *s) {
+    double minX = 1e300, minY = 1e300, maxX = -1e300, maxY = -1e300;
+    int i, j, k, n, first, depth;
+    quadNode *node, *parent;
+
+    for (i = 0; i < s->count; i++) {
+        minX = s->x[i] < minX ? s->x[i] : minX;
+        maxX = s->x[i] > maxX ? s->x[i] : maxX;
+        minY = s->y[i] < minY ? s->y[i] : minY;
+        maxY = s->y[i] > maxY ? s->y[i] : maxY;
+    }
+    if (!s->nodeCapacity) {
+        if (!grow((void **) &s->nodes, sizeof (quadNode), 1024))
+            return -1;
+        s->nodeCapacity = 1024;
+    }
+    s->noOfNodes = 1;
+    node = s->nodes;
+    node->cx = (minX + maxX) / 2;
+    node->cy = (minY + maxY) / 2;
+    node->half = (maxX - minX > maxY - minY ? maxX - minX : maxY - minY) / 2 + 1;
+    node->parent = node->firstChild = node->body = -1;
+    node->count = 0;
+
+    for (i = 0; i < s->count; i++) {
+        n = 0;
+        depth = 0;
+        while (true) {
+            node = s->nodes + n;
+            if (node->firstChild >= 0) {
+                n = node->firstChild + quadrant(node, s->x[i], s->y[i]);
+                depth++;
+            } else if (node->count < LEAF_SIZE || depth == MAX_DEPTH) {
+                push(s, node, i);
+                break;
+            } else {
+                if ((first = split(s, n)) < 0)
+                    return -1;
+                node = s->nodes + n;
+                for (j = node->body; j >= 0; j = k) {
+                    k = s->next[j];
+                    push(s, s->nodes + first + quadrant(node, s->x[j], s->y[j]), j);
+                }
+                node->firstChild = first;
+                node->body = -1;
+                node->count = 0;
+            }
+        }
+    }
+
+    /* children always come after their parent, so one backward pass sums them up */
+    for (n = 0; n < s->noOfNodes; n++)
+        s->nodes[n].x = s->nodes[n].y = s->nodes[n].mass = 0;
+    s->noOfLeaves = 0;
+    for (n = s->noOfNodes - 1; n >= 0; n--) {
+        node = s->nodes + n;
+        if (node->count) {
+            if (s->noOfLeaves == s->leafCapacity) {
+                if (!grow((void **) &s->leaves, sizeof (int), s->leafCapacity ? s->leafCapacity * 2 : 256))
+                    return -1;
+                s->leafCapacity = s->leafCapacity ? s->leafCapacity * 2 : 256;
+            }
+            s->leaves[s->noOfLeaves++] = n;
+        }
+        for (j = node->body; j >= 0; j = s->next[j]) {
+            node->x += s->mass[j] * s->x[j];
+            node->y += s->mass[j] * s->y[j];
+            node->mass += s->mass[j];
+        }
+        if (node->parent >= 0) {
+            parent = s->nodes + node->parent;
+            parent->x += node->x;
+            parent->y += node->y;
+            parent->mass += node->mass;
+        }
+        if (node->mass > 0) {
+            node->x /= node->mass;
+            node->y /= node->mass;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Accelerations of the bodies of one leaf. The tree is walked once for the
+ * whole leaf: a node is taken as a point mass when it is small enough
+ * seen from anywhere in the leaf's square, and every body then sums the
+ * same interaction list. The leaf's own bodies are on that list too; with
+ * softening a body exerts no force on itself, so it needs no special case.
+ */
+static void
+accelerateLeaf(nbodySystem *s, int leaf, interactionList *l) {
+    const double theta2 = openingAngle * openingAngle, eps2 = softening * softening;
+    const quadNode *group = s->nodes + leaf, *n;
+    int stack[3 * MAX_DEPTH + 4], top = 0, i, j;
+    double x, y, ax, ay, dx, dy, d2, f;
+
+    l->count = 0;
+    stack[top++] = 0;
+    while (top) {
+        n = s->nodes + stack[--top];
+        if (n->mass == 0)
+            continue;
+        if (n->firstChild < 0) {
+            for (j = n->body; j >= 0; j = s->next[j])
+                if (!listAppend(l, s->x[j], s->y[j], s->mass[j]))
+                    goto outOfMemory;
+            continue;
+        }
+        dx = fabs(n->x - group->cx) - group->half;
+        dy = fabs(n->y - group->cy) - group->half;
+        dx = dx > 0 ? dx : 0;
+        dy = dy > 0 ? dy : 0;
+        if (4 * n->half * n->half < theta2 * (dx * dx + dy * dy)) {
+            if (!listAppend(l, n->x, n->y, n->mass))
+                goto outOfMemory;
+        } else {
+            stack[top++] = n->firstChild;
+            stack[top++] = n->firstChild + 1;
+            stack[top++] = n->firstChild + 2;
+            stack[top++] = n->firstChild + 3;
+        }
+    }
+
+    for (i = group->body; i >= 0; i = s->next[i]) {
+        x = s->x[i];
+        y = s->y[i];
+        dx = s->sunX - x;
+        dy = s->sunY - y;
+        d2 = dx * dx + dy * dy + eps2;
+        f = s->sunMass / (d2 * sqrt(d2));
+        ax = f * dx;
+        ay = f * dy;
+        for (j = 0; j < l->count; j++) {
+            dx = l->x[j] - x;
+            dy = l->y[j] - y;
+            d2 = dx * dx + dy * dy + eps2;
+            f = l->mass[j] / (d2 * sqrt(d2));
+            ax += f * dx;
+            ay += f * dy;
+        }
+        s->ax[i] = ax;
+        s->ay[i] = ay;
+    }
+    return;
+outOfMemory:
+    fprintf(stderr, "nbody: out of memory for the interaction list\n");
+    exit(EXIT_FAILURE);
+}
+
+/* Takes chunks of leaves off a shared counter until none are left. */
+static void
+accelerateChunks(nbodySystem *s, interactionList *l) {
+    int from, i;
+    while ((from = __sync_fetch_and_add(&s->chunk, FORCE_CHUNK)) < s->noOfLeaves)
+        for (i = from; i < from + FORCE_CHUNK && i < s->noOfLeaves; i++)
+            accelerateLeaf(s, s->leaves[i], l);
+}
+
+static void *
+forceWorker(void *arg) {
+    nbodySystem *s = (nbodySystem *) arg;
+    interactionList l = {NULL, NULL, NULL, 0, 0};
+    int generation = 0;
+
+    pthread_mutex_lock(&s->lock);
+    while (true) {
+        while (s->generation == generation && !s->quit)
+            pthread_cond_wait(&s->start, &s->lock);
+        if (s->quit)
+            break;
+        generation = s->generation;
+        pthread_mutex_unlock(&s->lock);
+        accelerateChunks(s, &l);
+        pthread_mutex_lock(&s->lock);
+        if (--s->pending == 0)
+            pthread_cond_signal(&s->finished);
+    }
+    pthread_mutex_unlock(&s->lock);
+    listFree(&l);
+    return NULL;
+}
+
+static void
+computeForces(nbodySystem *s) {
+    if (buildTree(s) < 0) {
+        fprintf(stderr, "nbody: out of memory for the tree\n");
+        exit(EXIT_FAILURE);
+    }
+    s->chunk = 0;
+    pthread_mutex_lock(&s->lock);
+    s->pending = s->threads - 1;
+    s->generation++;
+    pthread_cond_broadcast(&s->start);
+    pthread_mutex_unlock(&s->lock);
+
+    accelerateChunks(s, &s->list);
+
+    pthread_mutex_lock(&s->lock);
+    while (s->pending)
+        pthread_cond_wait(&s->finished, &s->lock);
+    pthread_mutex_unlock(&s->lock);
+}
+
+void
+nbodyStep(nbodySystem *s, double h) {
+    int i;
+
+    if (!s->count)
+        return;
+    if (!s->primed) {
+        computeForces(s);
+        s->primed = true;
+    }
+    for (i = 0; i < s->count; i++) {
+        s->px[i] = s->x[i];
+        s->py[i] = s->y[i];
+        s->vx[i] += s->ax[i] * h / 2;
+        s->vy[i] += s->ay[i] * h / 2;
+        s->x[i] += s->vx[i] * h;
+        s->y[i] += s->vy[i] * h;
+    }
+    computeForces(s);
+    for (i = 0; i < s->count; i++) {
+        s->vx[i] += s->ax[i] * h / 2;
+        s->vy[i] += s->ay[i] * h / 2;
+    }
+    return;
+}
+
+void
+nbodyPositions(const nbodySystem *s, double alpha, double *x, double *y) {
+    for (int i = 0; i < s->count; i++) {
+        x[i] = s->px[i] + (s->x[i] - s->px[i]) * alpha;
+        y[i] = s->py[i] + (s->y[i] - s->py[i]) * alpha;
+    }
+    return;
+}
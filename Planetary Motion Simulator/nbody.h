@@ -0,0 +1,86 @@
+/*
+ * File:   nbody.h
+ * Author: dibyendu
+ *
+ * Gravity mode: bodies pull on each other instead of following fixed
+ * ellipses. Mutual forces come from a Barnes-Hut quadtree rebuilt every
+ * step, the sun is a fixed point mass, and positions advance with a
+ * kick-drift-kick leapfrog, so orbits neither gain nor bleed energy over
+ * long runs.
+ */
+
+#ifndef NBODY_H
+#define NBODY_H
+
+#include <pthread.h>
+#include "bodies.h"
+
+/*
+ * Children of a node are four consecutive entries of the arena, in the
+ * order of quadrant(); leaves chain their bodies through next. While the
+ * tree is built x, y hold mass weighted sums, afterwards the centre of mass.
+ */
+typedef struct {
+    double x, y, mass;
+    double cx, cy, half;
+    int parent, firstChild, body, count;
+} quadNode;
+
+/* Point masses one leaf of bodies interacts with. */
+typedef struct {
+    double *x, *y, *mass;
+    int count, capacity;
+} interactionList;
+
+/*
+ * Masses are in the units of the gravitational constant, i.e. G * m, and
+ * time is in ticks. The node arena only ever grows, so once warmed up a
+ * step allocates nothing.
+ */
+typedef struct {
+    int count, capacity;
+    double *x, *y, *px, *py, *vx, *vy, *ax, *ay, *mass;
+    int *next;
+    double sunX, sunY, sunMass;
+    bool primed;
+    quadNode *nodes;
+    int noOfNodes, nodeCapacity, *leaves, noOfLeaves, leafCapacity;
+    interactionList list;
+    int threads, pending, generation, chunk;
+    bool quit;
+    pthread_t *workers;
+    pthread_mutex_t lock;
+    pthread_cond_t start, finished;
+} nbodySystem;
+
+/*
+ * Starts threads - 1 helper threads for the force evaluation; the caller
+ * of nbodyStep is the last one. Returns -1 if out of memory.
+ */
+int nbodyInit(nbodySystem *s, double sunX, double sunY, int threads);
+void nbodyFree(nbodySystem *s);
+
+/* Returns the index of the new body or -1. */
+int nbodyAdd(nbodySystem *s, double x, double y, double vx, double vy, double mass);
+
+/*
+ * Adds a body of the given radius (in pixels) at (x, y) on a circular
+ * orbit around the sun, clockwise if asked to.
+ */
+int nbodyAddOrbiting(nbodySystem *s, double x, double y, double radius, bool clockwise);
+
+/*
+ * Seeds the system from the current positions of a body set: masses
+ * follow the volume of each body, planets start on circular orbits around
+ * the sun and moons on circular orbits around their parents, in the
+ * direction of their kinematic orbits. Body i of b becomes body i of s.
+ */
+int nbodySeed(nbodySystem *s, const bodySet *b);
+
+/* Advances every body by h ticks. */
+void nbodyStep(nbodySystem *s, double h);
+
+/* Positions interpolated between the last two steps. */
+void nbodyPositions(const nbodySystem *s, double alpha, double *x, double *y);
+
+#endif
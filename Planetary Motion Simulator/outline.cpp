@@ -0,0 +1,96 @@
+/*
+ * File:   outline.cpp
+ * Author: dibyendu
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "outline.h"
+
+/* Largest distance of a polygon from the curve it stands for, in pixels. */
+const double outlineTolerance = 0.25;
+
+static double *circles[OUTLINE_TIERS];
+
+int
+outlineTier(double radius) {
+    /* the sagitta of a chord of angle 2 pi / n is about radius (pi / n)^2 / 2 */
+    double n = M_PI * sqrt(radius / (2 * outlineTolerance));
+    int tier = 0;
+    while (tier < OUTLINE_TIERS - 1 && (16 << tier) < n)
+        tier++;
+    return tier;
+}
+
+const double *
+outlineCircle(int tier) {
+    int n = 16 << tier;
+    double *c;
+
+    if (circles[tier])
+        return circles[tier];
+    if (!(c = (double *) malloc(sizeof (double) * 2 * n)))
+        return NULL;
+    for (int i = 0; i < n; i++) {
+        c[2 * i] = cos(2 * M_PI * i / n);
+        c[2 * i + 1] = sin(2 * M_PI * i / n);
+    }
+    circles[tier] = c;
+    return c;
+}
+
+void
+orbitOutlinesInit(orbitOutlines *o) {
+    memset(o, 0, sizeof (orbitOutlines));
+}
+
+void
+orbitOutlinesFree(orbitOutlines *o) {
+    free(o->points);
+    free(o->start);
+    orbitOutlinesInit(o);
+}
+
+int
+orbitOutlinesBuild(orbitOutlines *o, const bodySet *b, bool changed, double cx, double cy,
+        double zoom, double x, double y) {
+    int i, j, n, total = 0, *start;
+    const double *circle;
+
+    if (!changed && o->start && zoom == o->zoom && x == o->x && y == o->y)
+        return 0;
+    if (!(start = (int *) realloc(o->start, sizeof (int) * (b->count + 1))))
+        return -1;
+    o->start = start;
+    for (i = 0; i < b->count; i++) {
+        start[i] = total;
+        /* one more vertex than the tier has, to close the polygon */
+        if (b->orbit[i])
+            total += (16 << outlineTier(fmax(b->semiMajor[i], b->semiMinor[i]) * zoom)) + 1;
+    }
+    start[b->count] = total;
+    if (total > o->capacity) {
+        XPoint *points = (XPoint *) realloc(o->points, sizeof (XPoint) * total);
+        if (!points)
+            return -1;
+        o->points = points;
+        o->capacity = total;
+    }
+    for (i = 0; i < b->count; i++) {
+        n = start[i + 1] - start[i] - 1;
+        if (n <= 0)
+            continue;
+        if (!(circle = outlineCircle(outlineTier(fmax(b->semiMajor[i], b->semiMinor[i]) * zoom))))
+            return -1;
+        for (j = 0; j <= n; j++) {
+            o->points[start[i] + j].x = (short) lround(x + zoom * (cx + b->semiMajor[i] * circle[2 * (j % n)]));
+            o->points[start[i] + j].y = (short) lround(y + zoom * (cy + b->semiMinor[i] * circle[2 * (j % n) + 1]));
+        }
+    }
+    o->count = b->count;
+    o->zoom = zoom;
+    o->x = x;
+    o->y = y;
+    return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * File:   outline.h
+ * Author: dibyendu
+ *
+ * Orbit outlines as polygons instead of arcs for the server to tessellate.
+ * The unit circle is kept in a few tiers of 16 up to 4096 vertices, and
+ * every orbit takes the smallest tier that keeps it within a quarter pixel
+ * of the true ellipse at the size it is shown, so the work an outline
+ * costs follows the pixels it covers. The polygons are built for one
+ * scale and only rebuilt when that changes.
+ */
+
+#ifndef OUTLINE_H
+#define OUTLINE_H
+
+#include <X11/Xlib.h>
+#include "bodies.h"
+
+#define OUTLINE_TIERS 9
+
+/* Tier of the unit circle for an ellipse whose larger semi axis spans radius pixels. */
+int outlineTier(double radius);
+
+/*
+ * cos and sin of 16 << tier evenly spaced angles, built on first use; NULL
+ * if out of memory.
+ */
+const double *outlineCircle(int tier);
+
+/*
+ * The closed polygon of orbit i starts at points + start[i] and ends just
+ * before start[i + 1]; orbits that are not drawn have none.
+ */
+typedef struct {
+    XPoint *points;
+    int *start, count, capacity;
+    double zoom, x, y;
+} orbitOutlines;
+
+void orbitOutlinesInit(orbitOutlines *o);
+void orbitOutlinesFree(orbitOutlines *o);
+
+/*
+ * Builds the outlines of the orbits of b around (cx, cy) in design
+ * coordinates, shown scaled by zoom and moved by (x, y). Does nothing
+ * if they are already built for that, unless the bodies changed.
+ * Returns -1 if out of memory.
+ */
+int orbitOutlinesBuild(orbitOutlines *o, const bodySet *b, bool changed, double cx, double cy,
+        double zoom, double x, double y);
+
+#endif
@@ -12,180 +12,1222 @@
 #include <time.h>
 #include <complex.h>
 #include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
 #include <X11/keysym.h>
-#define NO_OF_PLANETS 8
+#include "xcache.h"
+#include "raster.h"
+#include "xframe.h"
+#include "bodies.h"
+#include "nbody.h"
+#include "snapshot.h"
+#include "checkpoint.h"
+#include "outline.h"
+#include "trace.h"
 
-const double earthRadius = 6,
-             earthOrbitSemiMajor = 60,
-             earthOrbitSemiMinor = 40,
-             earthAngularVelocity = 2;
 /*
- * Mercury  Venus  Earth  Mars  Jupiter  Saturn  Uranus  Neptune
+ * The layout everything is computed in; a window of any other size shows
+ * it scaled by a viewport.
  */
-const double planetData[] = {0.6, 0.9, 1, 0.7, 5.4, 4.4, 2.6, 1.6,
-    2, 1.5, 1, 0.8, 0.72, 0.65, 0.58, 0.51,
-    0.6, 0.8, 1, 1.5, 3, 4.4, 6, 8,
-    0.4, 0.6, 0.8, 1.3, 2.8, 4.2, 5.8, 7.8,
-    0.2056, 0.0068, 0.0167, 0.0934, 0.0483, 0.0560, 0.0461, 0.0097};
-
 const int windowWidth = 1024,
           windowHeight = 768,
           rectWidth = 1000,
           rectHeight = 660,
           sunRadius = 10;
 
+/*
+ * Angular velocities are in degrees per tick, a tick being what one
+ * auto-repeated <RETURN> used to advance. Physics runs at a fixed step
+ * rate independent of the frame rate and positions are interpolated
+ * between the last two steps when drawn. Bodies smaller than a pixel are
+ * drawn as points.
+ */
+const double tickRate = 30,
+             stepRate = 120,
+             frameRate = 60,
+             maxTimeScale = 64,
+             maxKeplerTimeScale = 65536,
+             seekTicks = 1000,
+             pointRadius = 1,
+             addedRadius = 3,
+             coordinateLimit = 16000,
+             minSleep = 0.002;
+
+/*
+ * In gravity mode at most this many steps run between two snapshots; when
+ * the machine can not keep up the simulation slows down instead. Seeking
+ * runs up to maxSeekSteps between them, so the window keeps showing how
+ * far it got. Kepler orbits need neither, they are computed for any time
+ * directly, so they can be sped up much further.
+ */
+const int maxStepsPerSnapshot = 4,
+          maxSeekSteps = 256;
+
 const char *rect = "#00BBFF",
            *sun = "#FF0000",
-           *text = "#000000",
-           *planetColour[NO_OF_PLANETS] = {"#0000FF", "#229942", "#3594BB", "#A52828", "#C14B4B",
-				           "#62BFED", "#4CBA8B", "#AD6E4A"};
+           *added = "#FF8000",
+           *text = "#000000";
 const char *message = "Planetary Motion Simulator";
 
 typedef double complex Point;
 
+/*
+ * Everything that evolves, shared by the window and the headless renderer.
+ * Time is kept in ticks; in gravity mode the bodies' positions come from
+ * the N-body system instead of their orbital elements.
+ */
 typedef struct {
-    double radius, angVelocity, orbitSemiMajor, orbitSemiMinor, orbitEccentricity;
-} planet;
+    bodySet bodies;
+    nbodySystem system;
+    bool gravity;
+    double ticks, prevTicks, accumulator;
+    Point centre;
+    int sunX, sunY;
+} simulation;
 
-planet p[8];
+/*
+ * What the render thread knows of the bodies: how they look and what they
+ * circle, copied from the simulation once and extended as bodies are
+ * added, and where they are, interpolated from the latest snapshot. count
+ * is the number of bodies in that snapshot, known all of those asked for
+ * so far.
+ */
+typedef struct {
+    int count, known, capacity;
+    double *x, *y, *radius, cx, cy;
+    int *parent;
+    unsigned char *colour;
+} bodyView;
 
-Point
-pointOnEllipse(double semiMajor, double semiMinor, int angleInDegrees, Point centre) {
-    return centre + (creal(semiMajor * cexp(-M_PI * I * angleInDegrees / 180.0)) + I * cimag(semiMinor * cexp(-M_PI * I * angleInDegrees / 180.0)));
-}
+/*
+ * A body added by clicking, waiting for the simulation thread to pick it
+ * up.
+ */
+typedef struct {
+    double x, y;
+    bool clockwise;
+} addedBody;
+
+/*
+ * The simulation thread owns sim outright. The render thread passes its
+ * commands in under lock, picked up once per iteration, and positions come
+ * back through frames without any locking.
+ */
+typedef struct {
+    simulation sim;
+    tripleBuffer frames;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    bool paused, quit, rewind, save;
+    double timeScale, seekBy;
+    int ticks, noOfAdded, addedCapacity;
+    addedBody *added;
+    const char *checkpoint;
+} simulationThread;
+
+/*
+ * Per colour batches of what a frame draws, so that each colour costs one
+ * XFillArcs and one XDrawPoints however many bodies share it. rects keeps
+ * the last drawn extent of every arc for damage tracking.
+ */
+typedef struct {
+    XArc *arcs;
+    XPoint *points;
+    XRectangle *rects, pointBounds;
+    int arcStart[MAX_COLOURS + 1], pointStart[MAX_COLOURS + 1];
+} frameBatch;
+
+#define MAX_DAMAGE_RECTS 256
+
+/*
+ * Where the layout shows up in a window of width x height: scaled by zoom,
+ * as large as fits, and moved by (x, y) to be centred.
+ */
+typedef struct {
+    int width, height;
+    double zoom, x, y;
+} viewport;
+
+xcache *resources;
+
+/* NULL unless -trace or -stats asked for instrumentation. */
+tracer *trace;
+
+/* Thread numbers in the trace. */
+#define RENDER_THREAD 0
+#define SIMULATION_THREAD 1
 
 void
-setPlanetAttributes(planet *p) {
-    for (int i = 0; i < NO_OF_PLANETS; i++) {
-        p[i].radius = planetData[i] * earthRadius;
-        p[i].angVelocity = planetData[i + 8] * earthAngularVelocity;
-        p[i].orbitSemiMajor = planetData[i + 16] * earthOrbitSemiMajor;
-        p[i].orbitSemiMinor = planetData[i + 24] * earthOrbitSemiMinor;
-        p[i].orbitEccentricity = planetData[i + 32];
-    }
+viewportResize(viewport *v, int width, int height) {
+    v->width = width;
+    v->height = height;
+    v->zoom = fmin((double) width / windowWidth, (double) height / windowHeight);
+    v->x = (width - windowWidth * v->zoom) / 2;
+    v->y = (height - windowHeight * v->zoom) / 2;
     return;
 }
 
+/* Where the top of the frame around the bodies is in the window. */
 int
-drawText(Display *d, int screen, Window *w, GC *gc, const char *str) {
-    XFontStruct *font;
-    XColor textColor;
-    char **list;
-    int textWidth, textHeight, textX, textY, returnNo;
+viewportTop(const viewport *v) {
+    return (int) lround(v->y + v->zoom * ((windowHeight - rectHeight) / 2));
+}
 
-    list = XListFonts(d, "-*-*-bold-r-normal--*-*-100-100-c-*-*", 200, &returnNo);
-    if (returnNo) {
-        srand(time(NULL));
-        static int fontIndex = rand() % returnNo;
-        font = XLoadQueryFont(d, *(list + fontIndex));
-        XFreeFontNames(list);
-    }
+int
+drawText(Display *d, int screen, Window *w, GC *gc, const viewport *v, const char *str) {
+    XFontStruct *font = xcacheFont(resources);
+    int textWidth, textHeight, textX, textY;
 
     if (!font)
         return -1;
 
-    XParseColor(d, DefaultColormap(d, screen), text, &textColor);
-    XAllocColor(d, DefaultColormap(d, screen), &textColor);
-    XSetForeground(d, *gc, textColor.pixel);
+    XSetForeground(d, *gc, xcachePixel(resources, text));
     XSetBackground(d, *gc, WhitePixel(d, screen));
     XSetFont(d, *gc, font->fid);
 
-    textWidth = XTextWidth(font, str, strlen(str));
-    textHeight = font->ascent + font->descent;
-    textX = (windowWidth - textWidth) / 2;
-    textY = ((windowHeight - rectHeight) / 2 - textHeight) / 2 + textHeight / 2;
+    textWidth = xcacheTextWidth(resources, str);
+    textHeight = xcacheTextHeight(resources);
+    textX = (v->width - textWidth) / 2;
+    textY = (viewportTop(v) - textHeight) / 2 + textHeight / 2;
 
     XDrawImageString(d, *w, *gc, textX, textY, str, strlen(str));
     return 0;
 }
 
+double
+now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void
+showState(Display *d, Window w, bool paused, double timeScale) {
+    char title[80];
+    if (paused)
+        sprintf(title, "Planetary Motion Simulator Window (paused)");
+    else if (timeScale != 1)
+        sprintf(title, "Planetary Motion Simulator Window (x%g)", timeScale);
+    else
+        sprintf(title, "Planetary Motion Simulator Window");
+    XStoreName(d, w, title);
+    return;
+}
+
+/*
+ * Starts from a checkpoint if restore is given, in whichever mode it was
+ * written in, otherwise from the catalog (or the planets) at time 0.
+ */
+int
+simulationInit(simulation *sim, const char *catalog, const char *restore, bool gravity, int threads) {
+    int rectX = (windowWidth - rectWidth) / 2, rectY = (windowHeight - rectHeight) / 2;
+    checkpointHeader h;
+
+    bodySetInit(&sim->bodies);
+    sim->ticks = sim->prevTicks = sim->accumulator = 0;
+    sim->centre = rectX + (rectWidth / 2) + I * (rectY + (rectHeight / 2));
+    if (restore) {
+        if (checkpointPeek(restore, &h) < 0)
+            return -1;
+        gravity = h.gravity;
+        if (gravity && nbodyInit(&sim->system, h.sunX, h.sunY, threads) < 0) {
+            fprintf(stderr, "out of memory for %d bodies\n", h.count);
+            return -1;
+        }
+        if (checkpointLoad(restore, &sim->bodies, gravity ? &sim->system : NULL, &sim->ticks) < 0) {
+            if (gravity)
+                nbodyFree(&sim->system);
+            bodySetFree(&sim->bodies);
+            return -1;
+        }
+        sim->prevTicks = sim->ticks;
+    } else if (catalog) {
+        if (bodySetLoad(&sim->bodies, catalog) < 0)
+            return -1;
+    } else
+        bodySetAddPlanets(&sim->bodies);
+    sim->gravity = gravity;
+    sim->sunX = creal(sim->centre) - (sim->bodies.count ? sim->bodies.semiMajor[0] * sim->bodies.eccentricity[0] : 0) - 10;
+    sim->sunY = cimag(sim->centre);
+    if (gravity && !restore) {
+        bodySetPropagate(&sim->bodies, 0, creal(sim->centre), cimag(sim->centre));
+        if (nbodyInit(&sim->system, sim->sunX, sim->sunY, threads) < 0 || nbodySeed(&sim->system, &sim->bodies) < 0) {
+            fprintf(stderr, "out of memory for %d bodies\n", sim->bodies.count);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void
+simulationFree(simulation *sim) {
+    bodySetFree(&sim->bodies);
+    if (sim->gravity)
+        nbodyFree(&sim->system);
+    return;
+}
+
+/*
+ * Runs the fixed steps that fit into the given (already scaled) seconds,
+ * carrying the remainder over; with a step limit the rest is dropped.
+ * Kepler orbits take all their steps at once, whatever the time scale.
+ */
+void
+simulationAdvance(simulation *sim, double seconds, int maxSteps) {
+    double dt = 1 / stepRate;
+    int steps;
+
+    sim->accumulator += seconds;
+    if (!sim->gravity) {
+        steps = (int) floor(sim->accumulator / dt);
+        if (maxSteps && steps > maxSteps) {
+            steps = maxSteps;
+            sim->accumulator = fmod(sim->accumulator, dt) + steps * dt;
+        }
+        if (steps > 0) {
+            sim->prevTicks = sim->ticks + tickRate * dt * (steps - 1);
+            sim->ticks += tickRate * dt * steps;
+            sim->accumulator -= steps * dt;
+            sim->accumulator = sim->accumulator < 0 ? 0 : sim->accumulator;
+        }
+        return;
+    }
+    for (steps = 0; sim->accumulator >= dt; steps++) {
+        if (maxSteps && steps == maxSteps) {
+            sim->accumulator = fmod(sim->accumulator, dt);
+            break;
+        }
+        sim->prevTicks = sim->ticks;
+        sim->ticks += tickRate * dt;
+        sim->accumulator -= dt;
+        nbodyStep(&sim->system, tickRate * dt);
+    }
+    return;
+}
+
+/*
+ * Moves the simulation to the given time in ticks. Kepler orbits are in
+ * closed form, so they get there at once however far it is; gravity has
+ * to be stepped there, forwards only, at most maxSteps steps per call (no
+ * limit if 0). Returns 1 once there, 0 while steps remain, and -1 when
+ * gravity is asked to go back.
+ */
+int
+simulationSeek(simulation *sim, double ticks, int maxSteps) {
+    double h = tickRate / stepRate;
+
+    if (sim->gravity) {
+        if (ticks < sim->ticks - 1e-9)
+            return -1;
+        for (int steps = 0; ticks - sim->ticks > 1e-9 && (!maxSteps || steps < maxSteps); steps++) {
+            nbodyStep(&sim->system, ticks - sim->ticks < h ? ticks - sim->ticks : h);
+            sim->ticks = ticks - sim->ticks < h ? ticks : sim->ticks + h;
+        }
+    }
+    if (ticks - sim->ticks > 1e-9) {
+        sim->prevTicks = sim->ticks;
+        sim->accumulator = 0;
+        return 0;
+    }
+    sim->ticks = sim->prevTicks = ticks;
+    sim->accumulator = 0;
+    return 1;
+}
+
+int
+simulationSave(simulation *sim, const char *path) {
+    return checkpointSave(path, &sim->bodies, sim->gravity ? &sim->system : NULL, sim->ticks);
+}
+
+/* One whole tick at once, for stepping while paused. */
+void
+simulationTick(simulation *sim) {
+    double dt = 1 / stepRate;
+    if (sim->gravity)
+        for (int i = 0; i * tickRate * dt < 1; i++)
+            nbodyStep(&sim->system, tickRate * dt);
+    sim->prevTicks = ++sim->ticks;
+    return;
+}
+
+/* Positions of the bodies alpha of the way from the previous step to the last. */
+void
+simulationPositions(simulation *sim, double alpha) {
+    if (sim->gravity)
+        nbodyPositions(&sim->system, alpha, sim->bodies.x, sim->bodies.y);
+    else
+        bodySetPropagate(&sim->bodies, sim->prevTicks + (sim->ticks - sim->prevTicks) * alpha,
+                creal(sim->centre), cimag(sim->centre));
+    return;
+}
+
+/*
+ * Publishes the current positions, taken interval seconds after the last
+ * ones. Returns -1 if out of memory.
+ */
+int
+publish(simulationThread *t, double time, double interval) {
+    simulation *sim = &t->sim;
+    snapshot *s = tripleBufferBack(&t->frames, sim->bodies.count);
+
+    if (!s) {
+        fprintf(stderr, "out of memory for a snapshot of %d bodies\n", sim->bodies.count);
+        return -1;
+    }
+    simulationPositions(sim, 1);
+    memcpy(s->x, sim->bodies.x, sizeof (double) * sim->bodies.count);
+    memcpy(s->y, sim->bodies.y, sizeof (double) * sim->bodies.count);
+    s->time = time;
+    s->interval = interval;
+    tripleBufferPublish(&t->frames);
+    return 0;
+}
+
+/*
+ * Steps the simulation in real time, scaled, and publishes a snapshot
+ * whenever anything moved; in between it sleeps until the next step is
+ * due, but never less than minSleep, as Kepler orbits are due again almost
+ * at once at high time scales. Gravity, and a seek under way, go straight
+ * on with their next steps. Nothing here waits on the render thread or the
+ * X server.
+ */
+void *
+simulationMain(void *arg) {
+    simulationThread *t = (simulationThread *) arg;
+    simulation *sim = &t->sim;
+    double previous = now(), published = previous, current, timeScale, before, start, wait, target = 0;
+    bool paused, moved = false, seeking = false, jumped = false, save;
+    int ticks, i;
+
+    while (true) {
+        pthread_mutex_lock(&t->lock);
+        if (t->quit) {
+            pthread_mutex_unlock(&t->lock);
+            break;
+        }
+        paused = t->paused;
+        timeScale = t->timeScale;
+        ticks = t->ticks;
+        t->ticks = 0;
+        for (i = 0; i < t->noOfAdded; i++)
+            if (bodySetAdd(&sim->bodies, NULL, added, addedRadius / earthRadius, 0, 0, 0, 0, 0, -1, false) < 0
+                    || nbodyAddOrbiting(&sim->system, t->added[i].x, t->added[i].y, addedRadius, t->added[i].clockwise) < 0)
+                fprintf(stderr, "out of memory for body %d\n", sim->bodies.count);
+        moved |= t->noOfAdded > 0;
+        t->noOfAdded = 0;
+        if (t->rewind || t->seekBy != 0) {
+            target = t->rewind ? 0 : (seeking ? target : sim->ticks) + t->seekBy;
+            seeking = true;
+        }
+        t->rewind = false;
+        t->seekBy = 0;
+        save = t->save;
+        t->save = false;
+        pthread_mutex_unlock(&t->lock);
+
+        if (seeking) {
+            start = now();
+            i = simulationSeek(sim, target, maxSeekSteps);
+            if (i < 0)
+                fprintf(stderr, "gravity only runs forwards; restore a checkpoint to go back\n");
+            seeking = i == 0;
+            moved = jumped = true;
+            traceRecord(trace, "seek", SIMULATION_THREAD, start, now(), -1);
+        }
+        if (save) {
+            start = now();
+            if (simulationSave(sim, t->checkpoint) == 0)
+                fprintf(stderr, "saved tick %g to %s\n", sim->ticks, t->checkpoint);
+            traceRecord(trace, "save", SIMULATION_THREAD, start, now(), -1);
+        }
+
+        for (; ticks > 0; ticks--) {
+            simulationTick(sim);
+            moved = true;
+        }
+        current = now();
+        if (!paused) {
+            before = sim->ticks;
+            simulationAdvance(sim, (current - previous > 0.25 ? 0.25 : current - previous) * timeScale,
+                    sim->gravity ? maxStepsPerSnapshot : 0);
+            moved |= sim->ticks != before;
+            if (sim->ticks != before)
+                traceRecord(trace, "advance", SIMULATION_THREAD, current, now(), -1);
+        }
+        previous = current;
+
+        if (moved) {
+            /* after a pause or a jump there is nothing sensible to interpolate from */
+            start = now();
+            publish(t, current, paused || jumped || current - published > 0.25 ? 0 : current - published);
+            jumped = false;
+            traceRecord(trace, "publish", SIMULATION_THREAD, start, now(), -1);
+            published = current;
+            moved = false;
+            if (seeking || (sim->gravity && !paused))
+                continue;
+        }
+        wait = paused ? 0.01 : (1 / stepRate - sim->accumulator) / timeScale;
+        usleep((useconds_t) ((wait < minSleep ? minSleep : wait) * 1e6));
+    }
+    return NULL;
+}
+
+/* Starts the simulation thread on t->sim from a fresh triple buffer, with nothing pending. */
+int
+simulationThreadStart(simulationThread *t) {
+    tripleBufferInit(&t->frames);
+    t->quit = t->rewind = t->save = false;
+    t->ticks = t->noOfAdded = 0;
+    t->seekBy = 0;
+    if (publish(t, now(), 0) < 0 || pthread_create(&t->thread, NULL, simulationMain, t)) {
+        tripleBufferFree(&t->frames);
+        return -1;
+    }
+    return 0;
+}
+
+/* Stops it again; until the next start sim belongs to the caller. */
+void
+simulationThreadStop(simulationThread *t) {
+    pthread_mutex_lock(&t->lock);
+    t->quit = true;
+    pthread_mutex_unlock(&t->lock);
+    pthread_join(t->thread, NULL);
+    tripleBufferFree(&t->frames);
+    return;
+}
+
+double
+clampCoordinate(double v) {
+    /* bodies flung out of the system must not wrap around into view */
+    return v < -coordinateLimit ? -coordinateLimit : v > coordinateLimit ? coordinateLimit : v;
+}
+
+XRectangle
+bodyRect(double x, double y, double radius) {
+    XRectangle r;
+    r.x = (short) floor(x - radius) - 1;
+    r.y = (short) floor(y - radius) - 1;
+    r.width = r.height = (unsigned short) ceil(2 * radius) + 3;
+    return r;
+}
+
+int
+bodyViewInit(bodyView *v, const bodySet *b, Point centre) {
+    v->count = v->known = b->count;
+    v->capacity = b->count + 16;
+    v->cx = creal(centre);
+    v->cy = cimag(centre);
+    v->x = (double *) calloc(v->capacity, sizeof (double));
+    v->y = (double *) calloc(v->capacity, sizeof (double));
+    v->radius = (double *) malloc(sizeof (double) * v->capacity);
+    v->parent = (int *) malloc(sizeof (int) * v->capacity);
+    v->colour = (unsigned char *) malloc(v->capacity);
+    if (!v->x || !v->y || !v->radius || !v->parent || !v->colour)
+        return -1;
+    memcpy(v->radius, b->radius, sizeof (double) * b->count);
+    memcpy(v->parent, b->parent, sizeof (int) * b->count);
+    memcpy(v->colour, b->colour, b->count);
+    return 0;
+}
+
 void
-createGC(Display *d, Window *w, int screen, int lineWidth, GC *gc, const char *str, XColor *color) {
-    *gc = XCreateGC(d, *w, 0, 0);
-    XParseColor(d, DefaultColormap(d, screen), str, color);
-    XAllocColor(d, DefaultColormap(d, screen), color);
-    XSetForeground(d, *gc, color->pixel);
-    XSetLineAttributes(d, *gc, lineWidth, LineSolid, CapRound, JoinRound);
-    XSetFillStyle(d, *gc, FillSolid);
+bodyViewFree(bodyView *v) {
+    free(v->x);
+    free(v->y);
+    free(v->radius);
+    free(v->parent);
+    free(v->colour);
     return;
 }
 
+static bool
+grow(void **field, size_t size, int capacity) {
+    void *p = realloc(*field, size * capacity);
+    if (!p)
+        return false;
+    *field = p;
+    return true;
+}
+
 int
-main() {
+bodyViewAdd(bodyView *v, double radius, int colour) {
+    if (v->known == v->capacity) {
+        int capacity = v->capacity * 2;
+        if (!grow((void **) &v->x, sizeof (double), capacity)
+                || !grow((void **) &v->y, sizeof (double), capacity)
+                || !grow((void **) &v->radius, sizeof (double), capacity)
+                || !grow((void **) &v->parent, sizeof (int), capacity)
+                || !grow((void **) &v->colour, sizeof (unsigned char), capacity))
+            return -1;
+        v->capacity = capacity;
+    }
+    v->radius[v->known] = radius;
+    v->parent[v->known] = -1;
+    v->colour[v->known] = colour;
+    return v->known++;
+}
+
+/*
+ * Positions alpha of the way from the snapshot before s to s, swept around
+ * whatever each body circles (its parent, drawn first, or the sun) with the
+ * distance interpolated separately, so that a body stays on its orbit
+ * instead of cutting the chord inside it. A body that went a quarter turn
+ * or more between the two snapshots is snapped to where it is now. Returns
+ * true when the number of bodies shown changed.
+ */
+bool
+bodyViewUpdate(bodyView *v, const snapshot *s, double alpha) {
+    int count = s->count < v->known ? s->count : v->known, p;
+    bool changed = count != v->count;
+    double ax, ay, bx, by, ra, rb, x, y, r;
+
+    for (int i = 0; i < count; i++) {
+        p = v->parent[i];
+        ax = s->px[i] - (p >= 0 ? s->px[p] : v->cx);
+        ay = s->py[i] - (p >= 0 ? s->py[p] : v->cy);
+        bx = s->x[i] - (p >= 0 ? s->x[p] : v->cx);
+        by = s->y[i] - (p >= 0 ? s->y[p] : v->cy);
+        x = ax + (bx - ax) * alpha;
+        y = ay + (by - ay) * alpha;
+        r = sqrt(x * x + y * y);
+        if (ax * bx + ay * by <= 0 || r == 0) {
+            v->x[i] = s->x[i];
+            v->y[i] = s->y[i];
+            continue;
+        }
+        ra = sqrt(ax * ax + ay * ay);
+        rb = sqrt(bx * bx + by * by);
+        r = (ra + (rb - ra) * alpha) / r;
+        v->x[i] = (p >= 0 ? v->x[p] : v->cx) + x * r;
+        v->y[i] = (p >= 0 ? v->y[p] : v->cy) + y * r;
+    }
+    v->count = count;
+    return changed;
+}
+
+/* Bodies go in the point or the arc batches by their size in the viewport. */
+int
+frameBatchInit(frameBatch *f, const bodyView *b, const viewport *v) {
+    int i, arcCount[MAX_COLOURS] = {0}, pointCount[MAX_COLOURS] = {0};
+
+    for (i = 0; i < b->count; i++)
+        if (b->radius[i] * v->zoom < pointRadius)
+            pointCount[b->colour[i]]++;
+        else
+            arcCount[b->colour[i]]++;
+    f->arcStart[0] = f->pointStart[0] = 0;
+    for (i = 0; i < MAX_COLOURS; i++) {
+        f->arcStart[i + 1] = f->arcStart[i] + arcCount[i];
+        f->pointStart[i + 1] = f->pointStart[i] + pointCount[i];
+    }
+    f->arcs = (XArc *) malloc(sizeof (XArc) * (f->arcStart[MAX_COLOURS] + 1));
+    f->rects = (XRectangle *) calloc(f->arcStart[MAX_COLOURS] + 1, sizeof (XRectangle));
+    f->points = (XPoint *) malloc(sizeof (XPoint) * (f->pointStart[MAX_COLOURS] + 1));
+    memset(&f->pointBounds, 0, sizeof (XRectangle));
+    return f->arcs && f->rects && f->points ? 0 : -1;
+}
+
+void
+frameBatchFree(frameBatch *f) {
+    free(f->arcs);
+    free(f->rects);
+    free(f->points);
+    return;
+}
+
+/*
+ * Rebuilds the batches from the current positions and adds both the old and
+ * the new extent of everything to damage; past a few hundred arcs, or for
+ * points, a single bounding box stands in for the individual rectangles.
+ */
+void
+frameBatchFill(frameBatch *f, const bodyView *b, const viewport *v, Region damage) {
+    int i, j, arcNext[MAX_COLOURS], pointNext[MAX_COLOURS], noOfArcs = f->arcStart[MAX_COLOURS];
+    double minX = 1e9, minY = 1e9, maxX = -1e9, maxY = -1e9, x, y, radius;
+    XRectangle whole;
+
+    memcpy(arcNext, f->arcStart, sizeof (arcNext));
+    memcpy(pointNext, f->pointStart, sizeof (pointNext));
+    for (i = 0; i < noOfArcs; i++)
+        if (noOfArcs <= MAX_DAMAGE_RECTS)
+            XUnionRectWithRegion(&f->rects[i], damage, damage);
+    XUnionRectWithRegion(&f->pointBounds, damage, damage);
+
+    for (i = 0; i < b->count; i++) {
+        x = clampCoordinate(v->x + b->x[i] * v->zoom);
+        y = clampCoordinate(v->y + b->y[i] * v->zoom);
+        radius = b->radius[i] * v->zoom;
+        if (radius < pointRadius) {
+            j = pointNext[b->colour[i]]++;
+            f->points[j].x = (short) lround(x);
+            f->points[j].y = (short) lround(y);
+            minX = x < minX ? x : minX;
+            maxX = x > maxX ? x : maxX;
+            minY = y < minY ? y : minY;
+            maxY = y > maxY ? y : maxY;
+        } else {
+            j = arcNext[b->colour[i]]++;
+            f->rects[j] = bodyRect(x, y, radius);
+            f->arcs[j].x = (short) lround(x - radius);
+            f->arcs[j].y = (short) lround(y - radius);
+            f->arcs[j].width = f->arcs[j].height = (unsigned short) lround(2 * radius);
+            f->arcs[j].angle1 = 0;
+            f->arcs[j].angle2 = 360 * 64;
+            if (noOfArcs <= MAX_DAMAGE_RECTS)
+                XUnionRectWithRegion(&f->rects[j], damage, damage);
+        }
+    }
+    if (noOfArcs > MAX_DAMAGE_RECTS) {
+        /* the whole window is cheaper than a region of thousands of rectangles */
+        whole.x = whole.y = 0;
+        whole.width = v->width;
+        whole.height = v->height;
+        XUnionRectWithRegion(&whole, damage, damage);
+    }
+    if (minX <= maxX) {
+        f->pointBounds.x = (short) floor(minX) - 1;
+        f->pointBounds.y = (short) floor(minY) - 1;
+        f->pointBounds.width = (unsigned short) (ceil(maxX) - floor(minX)) + 3;
+        f->pointBounds.height = (unsigned short) (ceil(maxY) - floor(minY)) + 3;
+        XUnionRectWithRegion(&f->pointBounds, damage, damage);
+    }
+    return;
+}
+
+/* The frame around the bodies in the window, and how thick to draw it. */
+void
+frameRectangle(const viewport *v, int *x, int *y, int *width, int *height, int *lineWidth) {
+    *x = (int) lround(v->x + v->zoom * ((windowWidth - rectWidth) / 2));
+    *y = viewportTop(v);
+    *width = (int) lround(v->zoom * rectWidth);
+    *height = (int) lround(v->zoom * rectHeight);
+    *lineWidth = v->zoom > 1 ? (int) lround(2 * v->zoom) : 2;
+    return;
+}
+
+/*
+ * Everything that does not move: title, frame, sun and, unless gravity is
+ * in charge, orbits, drawn once into a pixmap that frames restore damaged
+ * areas from. The orbits are polygons from outlines, only as fine as
+ * their size in the viewport needs.
+ */
+void
+drawStaticScene(Display *d, int screen, Pixmap scene, const viewport *v, GC textGc, GC rectGc, GC sunGc, GC *colourGc,
+        GC invGc, const bodySet *b, const orbitOutlines *outlines, int sunX, int sunY) {
+    int rectX, rectY, width, height, lineWidth, radius = (int) lround(sunRadius * v->zoom);
+    int x = (int) lround(v->x + sunX * v->zoom), y = (int) lround(v->y + sunY * v->zoom);
+
+    frameRectangle(v, &rectX, &rectY, &width, &height, &lineWidth);
+    XFillRectangle(d, scene, invGc, 0, 0, v->width, v->height);
+    drawText(d, screen, &scene, &textGc, v, message);
+    XDrawRectangle(d, scene, rectGc, rectX, rectY, width, height);
+    XFillArc(d, scene, sunGc, x - radius, y - radius, radius * 2, radius * 2, 0, 360 * 64);
+    for (int i = 0; outlines && i < b->count; i++)
+        if (outlines->start[i + 1] > outlines->start[i])
+            XDrawLines(d, scene, colourGc[b->colour[i]], outlines->points + outlines->start[i],
+                    outlines->start[i + 1] - outlines->start[i], CoordModeOrigin);
+    return;
+}
+
+/*
+ * The static scene drawn in software, with the built in font for the
+ * title; colour maps the colour indices of b to pixels.
+ */
+void
+drawStaticRaster(raster *scene, const viewport *v, const bodySet *b, const unsigned int *colour, bool orbits, Point centre,
+        int sunX, int sunY) {
+    int rectX, rectY, width, height, lineWidth;
+
+    frameRectangle(v, &rectX, &rectY, &width, &height, &lineWidth);
+    rasterClear(scene, 0xFFFFFF);
+    rasterText(scene, (v->width - rasterTextWidth(message)) / 2,
+            (viewportTop(v) - RASTER_FONT_HEIGHT) / 2 + RASTER_FONT_HEIGHT / 2,
+            message, rasterColour(text));
+    rasterRectangle(scene, rectX, rectY, width, height, lineWidth, rasterColour(rect));
+    rasterFillCircle(scene, v->x + sunX * v->zoom, v->y + sunY * v->zoom, sunRadius * v->zoom, rasterColour(sun));
+    for (int i = 0; orbits && i < b->count; i++)
+        if (b->orbit[i])
+            rasterEllipse(scene, v->x + creal(centre) * v->zoom, v->y + cimag(centre) * v->zoom, b->semiMajor[i] * v->zoom,
+                    b->semiMinor[i] * v->zoom, colour[b->colour[i]]);
+    return;
+}
+
+/*
+ * The palette as GCs and as pixels, and the static scene drawn with them
+ * into the pixmap and, for software rendering, into sceneRaster; redone
+ * whenever the bodies are replaced (changed) or the window is resized.
+ * Lines get thicker with the zoom, orbits only once it reaches 2.
+ */
+int
+prepareScene(Display *d, int screen, const simulation *sim, const viewport *v, bool changed, Pixmap scene, GC textGc,
+        GC sunGc, GC invGc, GC *colourGc, unsigned int *colour, orbitOutlines *outlines, raster *sceneRaster) {
+    int rectX, rectY, width, height, lineWidth;
+    GC rectGc;
+
+    frameRectangle(v, &rectX, &rectY, &width, &height, &lineWidth);
+    rectGc = xcacheGC(resources, rect, lineWidth);
+    for (int i = 0; i < sim->bodies.noOfColours; i++) {
+        colourGc[i] = xcacheGC(resources, sim->bodies.colours[i], v->zoom >= 2 ? (int) v->zoom : 1);
+        colour[i] = rasterColour(sim->bodies.colours[i]);
+    }
+    if (!sim->gravity && orbitOutlinesBuild(outlines, &sim->bodies, changed, creal(sim->centre), cimag(sim->centre),
+            v->zoom, v->x, v->y) < 0)
+        return -1;
+    drawStaticScene(d, screen, scene, v, textGc, rectGc, sunGc, colourGc, invGc, &sim->bodies,
+            sim->gravity ? NULL : outlines, sim->sunX, sim->sunY);
+    if (sceneRaster)
+        drawStaticRaster(sceneRaster, v, &sim->bodies, colour, !sim->gravity, sim->centre, sim->sunX, sim->sunY);
+    return 0;
+}
+
+void
+drawBodies(raster *frame, const viewport *v, int count, const double *x, const double *y, const double *radius,
+        const unsigned char *colourIndex, const unsigned int *colour) {
+    double bx, by, r;
+    for (int i = 0; i < count; i++) {
+        bx = clampCoordinate(v->x + x[i] * v->zoom);
+        by = clampCoordinate(v->y + y[i] * v->zoom);
+        r = radius[i] * v->zoom;
+        if (r < pointRadius)
+            rasterPoint(frame, (int) lround(bx), (int) lround(by), colour[colourIndex[i]]);
+        else
+            rasterFillCircle(frame, bx, by, r, colour[colourIndex[i]]);
+    }
+    return;
+}
+
+/*
+ * The same scene drawn in software, frame after frame as fast as they can
+ * be drawn, each one advancing the simulation by 1 / frameRate seconds.
+ * Frames are as large as v and go out as a stream of PPM images or, for
+ * rgb, bare RGB bytes.
+ */
+int
+renderHeadless(simulation *sim, const viewport *v, FILE *out, int frames, bool rgb, bool timing) {
+    const bodySet *b = &sim->bodies;
+    raster scene, frame;
+    unsigned int colour[MAX_COLOURS];
+    int i, n;
+    double start = now(), t0, t1, t2, t3;
+
+    if (rasterInit(&scene, v->width, v->height) < 0 || rasterInit(&frame, v->width, v->height) < 0) {
+        fprintf(stderr, "out of memory for the frames\n");
+        return -1;
+    }
+    for (i = 0; i < b->noOfColours; i++)
+        colour[i] = rasterColour(b->colours[i]);
+    drawStaticRaster(&scene, v, b, colour, !sim->gravity, sim->centre, sim->sunX, sim->sunY);
+
+    for (n = 0; n < frames; n++) {
+        t0 = now();
+        simulationAdvance(sim, 1 / frameRate, 0);
+        simulationPositions(sim, sim->accumulator * stepRate);
+        t1 = now();
+        rasterCopy(&frame, &scene);
+        drawBodies(&frame, v, b->count, b->x, b->y, b->radius, b->colour, colour);
+        t2 = now();
+        if ((rgb ? rasterWriteRGB(&frame, out) : rasterWritePPM(&frame, out)) < 0) {
+            perror("can not write frame");
+            break;
+        }
+        t3 = now();
+        traceRecord(trace, "advance", RENDER_THREAD, t0, t1, -1);
+        traceRecord(trace, "draw", RENDER_THREAD, t1, t2, -1);
+        traceRecord(trace, "write", RENDER_THREAD, t2, t3, -1);
+        traceRecord(trace, "frame", RENDER_THREAD, t0, t3, -1);
+    }
+    fflush(out);
+    if (timing)
+        fprintf(stderr, "%d frames of %d bodies in %.3f s, %.1f frames/s\n", n, b->count, now() - start,
+                n / (now() - start));
+    rasterFree(&scene);
+    rasterFree(&frame);
+    return n == frames ? 0 : -1;
+}
+
+int
+main(int argc, char **argv) {
     Display *d;
     Window w;
-    GC planetGc[NO_OF_PLANETS], rectGc, textGc, sunGc, invGc;
-    XColor sunColor, rectColor, planetColor[NO_OF_PLANETS];
+    Pixmap scene, back;
+    Region damage;
+    XRectangle bounds;
+    GC colourGc[MAX_COLOURS], textGc, sunGc, invGc, copyGc;
     XEvent e;
     KeySym key;
-    int rectX = (windowWidth - rectWidth) / 2, rectY = (windowHeight - rectHeight) / 2;
-    Point pt[NO_OF_PLANETS], centre = rectX + (rectWidth / 2) + I * (rectY + (rectHeight / 2));
-    int prevAngle[NO_OF_PLANETS];
-    int s, sunX = creal(centre) - p[0].orbitSemiMajor * p[0].orbitEccentricity - 10, sunY = cimag(centre), i;
+    simulationThread t;
+    simulation *sim = &t.sim;
+    const snapshot *latest;
+    bodyView view;
+    frameBatch batch;
+    viewport vp;
+    orbitOutlines outlines;
+    xframe frame;
+    raster sceneRaster;
+    unsigned int colour[MAX_COLOURS];
+    tracer spans;
+    checkpointHeader header;
+    double timeScale = 1, nextFrame, current, alpha, scaleLimit, seekTo = 0, scale;
+    unsigned long requests;
+    bool paused = false, redrawAll = true, gravity = false, rgb = false, timing = false, software = false, stats = false,
+         seek = false;
+    struct pollfd connection;
+    const char *catalog = NULL, *output = NULL, *traceFile = NULL, *restore = NULL, *checkpoint = NULL;
+    FILE *out;
+    int s, i, threads = 0, addedColour = 0, frames = 600, width = windowWidth, height = windowHeight;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-gravity"))
+            gravity = true;
+        else if (!strcmp(argv[i], "-threads") && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+            output = argv[++i];
+        else if (!strcmp(argv[i], "-frames") && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            frames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-rgb"))
+            rgb = true;
+        else if (!strcmp(argv[i], "-timing"))
+            timing = true;
+        else if (!strcmp(argv[i], "-software"))
+            software = true;
+        else if (!strcmp(argv[i], "-trace") && i + 1 < argc)
+            traceFile = argv[++i];
+        else if (!strcmp(argv[i], "-stats"))
+            stats = true;
+        else if (!strcmp(argv[i], "-seek") && i + 1 < argc) {
+            seek = true;
+            seekTo = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-restore") && i + 1 < argc)
+            restore = argv[++i];
+        else if (!strcmp(argv[i], "-checkpoint") && i + 1 < argc)
+            checkpoint = argv[++i];
+        else if (!strcmp(argv[i], "-size") && i + 1 < argc && sscanf(argv[i + 1], "%dx%d", &width, &height) == 2
+                && width > 0 && height > 0 && width <= RASTER_MAX_SIZE && height <= RASTER_MAX_SIZE)
+            i++;
+        else if (argv[i][0] != '-' && !catalog)
+            catalog = argv[i];
+        else {
+            fprintf(stderr, "usage: %s [-gravity] [-threads <count>] [-software] [-trace <file>] [-stats] [-seek <ticks>]\n"
+                    "              [-restore <checkpoint>] [-checkpoint <file>] [<catalog>]\n"
+                    "       %s -o <output> [-size <width>x<height>] [-frames <count>] [-rgb] [-timing] [-trace <file>]\n"
+                    "              [-stats] [-gravity] [-threads <count>] [-seek <ticks>] [-restore <checkpoint>]\n"
+                    "              [-checkpoint <file>] [<catalog>]\n",
+                    argv[0], argv[0]);
+            return (EXIT_FAILURE);
+        }
+    }
+    if (!threads)
+        threads = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+    if (traceFile || stats) {
+        traceInit(&spans);
+        trace = &spans;
+    }
+
+    if (simulationInit(sim, catalog, restore, gravity, threads) < 0)
+        return (EXIT_FAILURE);
+    gravity = sim->gravity;
+    if (seek && simulationSeek(sim, seekTo, 0) < 0) {
+        fprintf(stderr, "%s: gravity only runs forwards, from tick %g\n", argv[0], sim->ticks);
+        return (EXIT_FAILURE);
+    }
+    if (output) {
+        if (!(out = strcmp(output, "-") ? fopen(output, "wb") : stdout)) {
+            perror(output);
+            return (EXIT_FAILURE);
+        }
+        viewportResize(&vp, width, height);
+        i = renderHeadless(sim, &vp, out, frames, rgb, timing);
+        if (out != stdout)
+            fclose(out);
+        /* where a long headless run ended, to pick it up again later */
+        if (i == 0 && checkpoint)
+            i = simulationSave(sim, checkpoint);
+        traceReport(trace, traceFile, stats ? stderr : NULL, "frame");
+        if (trace)
+            traceFree(trace);
+        simulationFree(sim);
+        return i < 0 ? (EXIT_FAILURE) : (EXIT_SUCCESS);
+    }
+    if (!checkpoint)
+        checkpoint = restore ? restore : "planet.ckpt";
+    if (gravity)
+        addedColour = bodySetColour(&sim->bodies, added);
 
     d = XOpenDisplay(NULL);
     s = DefaultScreen(d);
-    w = XCreateSimpleWindow(d, RootWindow(d, s), 0, 0, windowWidth, windowHeight, 0, 0, WhitePixel(d, s));
 
-    setPlanetAttributes(p);
+    /* as many screen pixels to a layout pixel as the screen is dense, as long as it fits */
+    scale = xcacheScale(d, s);
+    viewportResize(&vp, windowWidth * scale < DisplayWidth(d, s) ? (int) (windowWidth * scale) : DisplayWidth(d, s),
+            windowHeight * scale < DisplayHeight(d, s) ? (int) (windowHeight * scale) : DisplayHeight(d, s));
+    width = vp.width;
+    height = vp.height;
+    orbitOutlinesInit(&outlines);
+    if (bodyViewInit(&view, &sim->bodies, sim->centre) < 0 || frameBatchInit(&batch, &view, &vp) < 0) {
+        fprintf(stderr, "%s: out of memory for %d bodies\n", argv[0], sim->bodies.count);
+        return (EXIT_FAILURE);
+    }
+    w = XCreateSimpleWindow(d, RootWindow(d, s), 0, 0, vp.width, vp.height, 0, 0, WhitePixel(d, s));
 
     XStoreName(d, w, "Planetary Motion Simulator Window");
-    XSelectInput(d, w, ExposureMask | KeyPressMask);
+    XSelectInput(d, w, ExposureMask | KeyPressMask | StructureNotifyMask | (gravity ? ButtonPressMask : 0));
     XMapWindow(d, w);
-    XMoveWindow(d, w, (DisplayWidth(d, s) - windowWidth) / 2, (DisplayHeight(d, s) - windowHeight) / 2);
+    XMoveWindow(d, w, (DisplayWidth(d, s) - vp.width) / 2, (DisplayHeight(d, s) - vp.height) / 2);
 
+    resources = xcacheOpen(d, s, w);
     textGc = XCreateGC(d, w, 0, 0);
 
-    createGC(d, &w, s, 2, &rectGc, rect, &rectColor);
-    createGC(d, &w, s, 1, &sunGc, sun, &sunColor);
-    for (i = 0; i < NO_OF_PLANETS; i++)
-        createGC(d, &w, s, 1, &planetGc[i], planetColour[i], &planetColor[i]);
+    sunGc = xcacheGC(resources, sun, 1);
 
     invGc = XCreateGC(d, w, 0, 0);
     XSetForeground(d, invGc, WhitePixel(d, s));
     XSetFillStyle(d, invGc, FillSolid);
+    copyGc = XCreateGC(d, w, 0, 0);
+    XSetGraphicsExposures(d, copyGc, False);
 
-    for (i = 0; i < NO_OF_PLANETS; i++)
-        prevAngle[i] = 90 * i;
+    scene = XCreatePixmap(d, w, vp.width, vp.height, DefaultDepth(d, s));
+    back = XCreatePixmap(d, w, vp.width, vp.height, DefaultDepth(d, s));
+
+    /*
+     * Software rendering draws every frame into an image and presents it
+     * with one request, instead of a request per colour batch on the
+     * server; only where the visual takes our pixels as they are.
+     */
+    if (software && xframeInit(&frame, d, s, vp.width, vp.height) < 0) {
+        fprintf(stderr, "%s: the display does not take 32 bit RGB images, drawing with Xlib\n", argv[0]);
+        software = false;
+    }
+    if (software) {
+        if (rasterInit(&sceneRaster, vp.width, vp.height) < 0) {
+            fprintf(stderr, "%s: out of memory for the frames\n", argv[0]);
+            return (EXIT_FAILURE);
+        }
+        if (!frame.shared)
+            fprintf(stderr, "%s: no shared memory with the display, frames go through the connection\n", argv[0]);
+    }
+    if (prepareScene(d, s, sim, &vp, true, scene, textGc, sunGc, invGc, colourGc, colour, &outlines,
+            software ? &sceneRaster : NULL) < 0) {
+        fprintf(stderr, "%s: out of memory for the orbits\n", argv[0]);
+        return (EXIT_FAILURE);
+    }
+
+    /* from here on only the simulation thread touches sim, unless it is stopped */
+    pthread_mutex_init(&t.lock, NULL);
+    t.paused = false;
+    t.timeScale = timeScale;
+    t.addedCapacity = 0;
+    t.added = NULL;
+    t.checkpoint = checkpoint;
+    scaleLimit = gravity ? maxTimeScale : maxKeplerTimeScale;
+    if (simulationThreadStart(&t) < 0) {
+        fprintf(stderr, "%s: can not start the simulation thread\n", argv[0]);
+        return (EXIT_FAILURE);
+    }
+
+    connection.fd = ConnectionNumber(d);
+    connection.events = POLLIN;
+    nextFrame = now();
 
     while (true) {
-        XNextEvent(d, &e);
-        switch (e.type) {
-            case Expose:
-                drawText(d, s, &w, &textGc, message);
-                XDrawRectangle(d, w, rectGc, rectX, rectY, rectWidth, rectHeight);
-                XFillArc(d, w, sunGc, sunX - sunRadius, sunY - sunRadius, sunRadius * 2, sunRadius * 2, 0, 360 * 64);
-                for (i = 0; i < NO_OF_PLANETS; i++) {
-                    pt[i] = pointOnEllipse(p[i].orbitSemiMajor, p[i].orbitSemiMinor, prevAngle[i], centre);
-                    XDrawArc(d, w, planetGc[i], creal(centre) - p[i].orbitSemiMajor, cimag(centre) - p[i].orbitSemiMinor,
-                            p[i].orbitSemiMajor * 2, p[i].orbitSemiMinor * 2, 0, 360 * 64);
-                    XFillArc(d, w, planetGc[i], creal(pt[i]) - p[i].radius, cimag(pt[i]) - p[i].radius,
-                            p[i].radius * 2, p[i].radius * 2, 0, 360 * 64);
+        while (XPending(d)) {
+            XNextEvent(d, &e);
+            if (e.type == Expose && !redrawAll && software)
+                xframePut(&frame, w, invGc, e.xexpose.x, e.xexpose.y, e.xexpose.width, e.xexpose.height);
+            else if (e.type == Expose && !redrawAll)
+                XCopyArea(d, back, w, invGc, e.xexpose.x, e.xexpose.y, e.xexpose.width, e.xexpose.height,
+                        e.xexpose.x, e.xexpose.y);
+            if (e.type == ConfigureNotify) {
+                /* resizes come in bursts while dragging, only the last one is acted on */
+                width = e.xconfigure.width;
+                height = e.xconfigure.height;
+            }
+            if (e.type == ButtonPress && e.xbutton.button == Button1) {
+                /* a new body on a circular orbit, clockwise with the shift key */
+                pthread_mutex_lock(&t.lock);
+                if (t.noOfAdded == t.addedCapacity) {
+                    t.addedCapacity = t.addedCapacity ? t.addedCapacity * 2 : 16;
+                    t.added = (addedBody *) realloc(t.added, sizeof (addedBody) * t.addedCapacity);
+                }
+                if (!t.added || bodyViewAdd(&view, addedRadius, addedColour) < 0) {
+                    pthread_mutex_unlock(&t.lock);
+                    goto quit;
                 }
-                break;
-            case KeyPress:
-                key = XLookupKeysym(&e.xkey, 0);
-                if (key == XK_Return) {
-                    drawText(d, s, &w, &textGc, message);
-                    for (i = 0; i < NO_OF_PLANETS; i++)
-                        XFillArc(d, w, invGc, creal(pt[i]) - p[i].radius, cimag(pt[i]) - p[i].radius,
-                            p[i].radius * 2, p[i].radius * 2, 0, 360 * 64);
-                    XDrawRectangle(d, w, rectGc, rectX, rectY, rectWidth, rectHeight);
-                    XFillArc(d, w, sunGc, sunX - sunRadius, sunY - sunRadius, sunRadius * 2, sunRadius * 2, 0, 360 * 64);
-                    for (i = 0; i < NO_OF_PLANETS; i++) {
-                        pt[i] = pointOnEllipse(p[i].orbitSemiMajor, p[i].orbitSemiMinor, prevAngle[i], centre);
-                        XDrawArc(d, w, planetGc[i], creal(centre) - p[i].orbitSemiMajor, cimag(centre) - p[i].orbitSemiMinor,
-                                p[i].orbitSemiMajor * 2, p[i].orbitSemiMinor * 2, 0, 360 * 64);
-                        XFillArc(d, w, planetGc[i], creal(pt[i]) - p[i].radius, cimag(pt[i]) - p[i].radius,
-                                p[i].radius * 2, p[i].radius * 2, 0, 360 * 64);
-                        prevAngle[i] += p[i].angVelocity * (i == 1 || i == 6 ? -1 : 1); // venus & uranus rotate clockwise
-                        prevAngle[i] %= 360;
-                    }
-                } else exit(0);
+                t.added[t.noOfAdded].x = (e.xbutton.x - vp.x) / vp.zoom;
+                t.added[t.noOfAdded].y = (e.xbutton.y - vp.y) / vp.zoom;
+                t.added[t.noOfAdded++].clockwise = e.xbutton.state & ShiftMask;
+                pthread_mutex_unlock(&t.lock);
+            }
+            if (e.type != KeyPress)
+                continue;
+            key = XLookupKeysym(&e.xkey, 0);
+            if (key == XK_space)
+                paused = !paused;
+            else if (key == XK_Return) {
+                if (paused) {
+                    pthread_mutex_lock(&t.lock);
+                    t.ticks++;
+                    pthread_mutex_unlock(&t.lock);
+                }
+            } else if (key == XK_equal || key == XK_plus || key == XK_KP_Add)
+                timeScale = timeScale * 2 > scaleLimit ? scaleLimit : timeScale * 2;
+            else if (key == XK_minus || key == XK_KP_Subtract)
+                timeScale = timeScale / 2 < 1 / maxTimeScale ? 1 / maxTimeScale : timeScale / 2;
+            else if (key == XK_Page_Up || key == XK_Page_Down || key == XK_Home || key == XK_s) {
+                pthread_mutex_lock(&t.lock);
+                t.seekBy += key == XK_Page_Up ? seekTicks : key == XK_Page_Down ? -seekTicks : 0;
+                t.rewind |= key == XK_Home;
+                t.save |= key == XK_s;
+                pthread_mutex_unlock(&t.lock);
+            } else if (key == XK_l) {
+                /* the bodies may all be different, so everything built from them is rebuilt */
+                if (checkpointPeek(checkpoint, &header) < 0)
+                    continue;
+                if (header.gravity != gravity) {
+                    fprintf(stderr, "%s: %s was saved in the other mode\n", argv[0], checkpoint);
+                    continue;
+                }
+                simulationThreadStop(&t);
+                simulationFree(sim);
+                frameBatchFree(&batch);
+                bodyViewFree(&view);
+                if (simulationInit(sim, NULL, checkpoint, gravity, threads) < 0)
+                    return (EXIT_FAILURE);
+                if (gravity)
+                    addedColour = bodySetColour(&sim->bodies, added);
+                if (bodyViewInit(&view, &sim->bodies, sim->centre) < 0 || frameBatchInit(&batch, &view, &vp) < 0
+                        || prepareScene(d, s, sim, &vp, true, scene, textGc, sunGc, invGc, colourGc, colour, &outlines,
+                        software ? &sceneRaster : NULL) < 0) {
+                    fprintf(stderr, "%s: out of memory for %d bodies\n", argv[0], sim->bodies.count);
+                    return (EXIT_FAILURE);
+                }
+                if (simulationThreadStart(&t) < 0) {
+                    fprintf(stderr, "%s: can not start the simulation thread\n", argv[0]);
+                    return (EXIT_FAILURE);
+                }
+                redrawAll = true;
+            } else if (!IsModifierKey(key))
+                goto quit;
+            pthread_mutex_lock(&t.lock);
+            t.paused = paused;
+            t.timeScale = timeScale;
+            pthread_mutex_unlock(&t.lock);
+            showState(d, w, paused, timeScale);
         }
+
+        current = now();
+        if (current < nextFrame) {
+            poll(&connection, 1, (int) ceil((nextFrame - current) * 1000));
+            continue;
+        }
+        nextFrame += 1 / frameRate;
+        if (nextFrame < current)
+            nextFrame = current + 1 / frameRate;     // fell behind, don't try to catch up
+        requests = NextRequest(d);
+
+        if (width != vp.width || height != vp.height) {
+            /* everything the size of the window is made again, the bodies are left as they are */
+            viewportResize(&vp, width, height);
+            XFreePixmap(d, scene);
+            XFreePixmap(d, back);
+            scene = XCreatePixmap(d, w, vp.width, vp.height, DefaultDepth(d, s));
+            back = XCreatePixmap(d, w, vp.width, vp.height, DefaultDepth(d, s));
+            if (software) {
+                xframeFree(&frame);
+                rasterFree(&sceneRaster);
+                if (xframeInit(&frame, d, s, vp.width, vp.height) < 0)
+                    software = false;
+                else if (rasterInit(&sceneRaster, vp.width, vp.height) < 0) {
+                    xframeFree(&frame);
+                    software = false;
+                }
+                if (!software)
+                    fprintf(stderr, "%s: no frames of %dx%d, drawing with Xlib\n", argv[0], vp.width, vp.height);
+            }
+            frameBatchFree(&batch);
+            if (frameBatchInit(&batch, &view, &vp) < 0
+                    || prepareScene(d, s, sim, &vp, false, scene, textGc, sunGc, invGc, colourGc, colour, &outlines,
+                    software ? &sceneRaster : NULL) < 0)
+                goto quit;
+            redrawAll = true;
+        }
+
+        /* whatever the simulation published last, one snapshot interval behind */
+        latest = tripleBufferFront(&t.frames);
+        if (!latest)
+            continue;
+        alpha = latest->interval > 0 ? (current - latest->time) / latest->interval : 1;
+        if (bodyViewUpdate(&view, latest, alpha < 0 ? 0 : alpha > 1 ? 1 : alpha)) {
+            frameBatchFree(&batch);
+            if (frameBatchInit(&batch, &view, &vp) < 0)
+                goto quit;
+            redrawAll = true;
+        }
+
+        /*
+         * Damage is where the bodies were plus where they are now. The
+         * static scene is restored under it, the bodies drawn on top, and
+         * the result presented with a single clipped copy.
+         */
+        damage = XCreateRegion();
+        frameBatchFill(&batch, &view, &vp, damage);
+        if (redrawAll) {
+            bounds.x = bounds.y = 0;
+            bounds.width = vp.width;
+            bounds.height = vp.height;
+            XUnionRectWithRegion(&bounds, damage, damage);
+            redrawAll = false;
+        }
+        XClipBox(damage, &bounds);
+        if (software) {
+            /* the frame keeps the last one, so only the bounds of the damage change */
+            rasterCopyRectangle(&frame.r, &sceneRaster, bounds.x, bounds.y, bounds.width, bounds.height);
+            rasterClip(&frame.r, bounds.x, bounds.y, bounds.width, bounds.height);
+            drawBodies(&frame.r, &vp, view.count, view.x, view.y, view.radius, view.colour, colour);
+            xframePut(&frame, w, copyGc, bounds.x, bounds.y, bounds.width, bounds.height);
+        } else {
+            XSetRegion(d, copyGc, damage);
+            XCopyArea(d, scene, back, copyGc, bounds.x, bounds.y, bounds.width, bounds.height, bounds.x, bounds.y);
+            for (i = 0; i < MAX_COLOURS; i++) {
+                if (batch.pointStart[i + 1] > batch.pointStart[i])
+                    XDrawPoints(d, back, colourGc[i], batch.points + batch.pointStart[i],
+                            batch.pointStart[i + 1] - batch.pointStart[i], CoordModeOrigin);
+                if (batch.arcStart[i + 1] > batch.arcStart[i])
+                    XFillArcs(d, back, colourGc[i], batch.arcs + batch.arcStart[i], batch.arcStart[i + 1] - batch.arcStart[i]);
+            }
+            XCopyArea(d, back, w, copyGc, bounds.x, bounds.y, bounds.width, bounds.height, bounds.x, bounds.y);
+        }
+        XDestroyRegion(damage);
+        XFlush(d);
+        traceRecord(trace, "frame", RENDER_THREAD, current, now(), NextRequest(d) - requests);
+    }
+quit:
+    simulationThreadStop(&t);
+    traceReport(trace, traceFile, stats ? stderr : NULL, "frame");
+    if (trace)
+        traceFree(trace);
+    if (software) {
+        xframeFree(&frame);
+        rasterFree(&sceneRaster);
     }
+    XFreePixmap(d, scene);
+    XFreePixmap(d, back);
+    XFreeGC(d, copyGc);
+    XFreeGC(d, textGc);
+    XFreeGC(d, invGc);
+    xcacheClose(resources);
     XDestroyWindow(d, w);
     XCloseDisplay(d);
+    frameBatchFree(&batch);
+    bodyViewFree(&view);
+    orbitOutlinesFree(&outlines);
+    pthread_mutex_destroy(&t.lock);
+    free(t.added);
+    simulationFree(sim);
     return (EXIT_SUCCESS);
 }
@@ -0,0 +1,88 @@
+/*
+ * File:   snapshot.cpp
+ * Author: dibyendu
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "snapshot.h"
+
+/* set in middle when it holds a snapshot the reader has not seen */
+#define FRESH 4
+
+void
+tripleBufferInit(tripleBuffer *t) {
+    memset(t, 0, sizeof (tripleBuffer));
+    t->back = 0;
+    t->middle = 1;
+    t->front = 2;
+    t->last = -1;
+}
+
+void
+tripleBufferFree(tripleBuffer *t) {
+    for (int i = 0; i < 3; i++) {
+        free(t->slots[i].x);
+        free(t->slots[i].y);
+        free(t->slots[i].px);
+        free(t->slots[i].py);
+    }
+    memset(t, 0, sizeof (tripleBuffer));
+}
+
+static bool
+grow(double **field, int capacity) {
+    double *p = (double *) realloc(*field, sizeof (double) * capacity);
+    if (!p)
+        return false;
+    *field = p;
+    return true;
+}
+
+snapshot *
+tripleBufferBack(tripleBuffer *t, int count) {
+    snapshot *s = t->slots + t->back;
+    const snapshot *last = t->last >= 0 ? t->slots + t->last : NULL;
+
+    if (count > s->capacity) {
+        int capacity = s->capacity ? s->capacity : 64;
+        while (capacity < count)
+            capacity *= 2;
+        if (!grow(&s->x, capacity) || !grow(&s->y, capacity) || !grow(&s->px, capacity) || !grow(&s->py, capacity))
+            return NULL;
+        s->capacity = capacity;
+    }
+    /* the last snapshot is only ever read from now on, by either side */
+    s->count = count;
+    if (last) {
+        memcpy(s->px, last->x, sizeof (double) * (last->count < count ? last->count : count));
+        memcpy(s->py, last->y, sizeof (double) * (last->count < count ? last->count : count));
+    }
+    return s;
+}
+
+void
+tripleBufferPublish(tripleBuffer *t) {
+    snapshot *s = t->slots + t->back;
+    int i = t->last >= 0 ? t->slots[t->last].count : 0;
+
+    /* bodies that are new in this snapshot stand still for it */
+    for (; i < s->count; i++) {
+        s->px[i] = s->x[i];
+        s->py[i] = s->y[i];
+    }
+    t->last = t->back;
+    __sync_synchronize();
+    t->back = __sync_lock_test_and_set(&t->middle, t->back | FRESH) & ~FRESH;
+}
+
+const snapshot *
+tripleBufferFront(tripleBuffer *t) {
+    if (t->middle & FRESH) {
+        /* everything read from the old front is done before the writer can get it */
+        __sync_synchronize();
+        t->front = __sync_lock_test_and_set(&t->middle, t->front) & ~FRESH;
+        t->started = true;
+    }
+    return t->started ? t->slots + t->front : NULL;
+}
@@ -0,0 +1,46 @@
+/*
+ * File:   snapshot.h
+ * Author: dibyendu
+ *
+ * Hands body positions from the simulation thread to the render thread
+ * through a triple buffer: the writer fills its back slot and swaps it with
+ * the middle one, the reader swaps the middle slot for its front one when
+ * something new has been published. Neither side ever waits for the other
+ * and the reader always gets the latest complete snapshot.
+ */
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+/*
+ * Positions at time, and those of the snapshot published before it, which
+ * came interval seconds earlier (0 while nothing moves).
+ */
+typedef struct {
+    double *x, *y, *px, *py;
+    int count, capacity;
+    double time, interval;
+} snapshot;
+
+/* back and last belong to the writer, front and started to the reader. */
+typedef struct {
+    snapshot slots[3];
+    int back, front, last;
+    bool started;
+    volatile int middle;
+} tripleBuffer;
+
+void tripleBufferInit(tripleBuffer *t);
+void tripleBufferFree(tripleBuffer *t);
+
+/*
+ * Writer side: the slot to fill, grown to hold count bodies with the
+ * previous positions already copied in; NULL if out of memory.
+ */
+snapshot *tripleBufferBack(tripleBuffer *t, int count);
+void tripleBufferPublish(tripleBuffer *t);
+
+/* Reader side: the latest published snapshot, or NULL before the first one. */
+const snapshot *tripleBufferFront(tripleBuffer *t);
+
+#endif
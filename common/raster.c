@@ -0,0 +1,327 @@
+/*
+ * File:   raster.c
+ * Author: dibyendu
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "raster.h"
+
+/*
+ * Printable ASCII from ' ' to '~', one byte per row with the leftmost pixel
+ * in the top bit; rendered from DejaVu Sans Mono at 12 pixels.
+ */
+static const unsigned char font[95][RASTER_FONT_HEIGHT] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /*   */
+    {0x00, 0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x10, 0x10, 0x00, 0x00, 0x00}, /* ! */
+    {0x00, 0x00, 0x28, 0x28, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* " */
+    {0x00, 0x00, 0x00, 0x14, 0x24, 0x7E, 0x28, 0x28, 0xFC, 0x48, 0x50, 0x00, 0x00, 0x00}, /* # */
+    {0x00, 0x00, 0x10, 0x38, 0x54, 0x50, 0x70, 0x1C, 0x14, 0x54, 0x38, 0x10, 0x10, 0x00}, /* $ */
+    {0x00, 0x00, 0x60, 0x90, 0x90, 0x64, 0x18, 0x6C, 0x12, 0x12, 0x0C, 0x00, 0x00, 0x00}, /* % */
+    {0x00, 0x00, 0x1C, 0x20, 0x20, 0x30, 0x30, 0x4A, 0x4E, 0x64, 0x3A, 0x00, 0x00, 0x00}, /* & */
+    {0x00, 0x00, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* ' */
+    {0x00, 0x0C, 0x08, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x08, 0x08, 0x0C, 0x00, 0x00}, /* ( */
+    {0x00, 0x30, 0x10, 0x10, 0x08, 0x08, 0x08, 0x08, 0x08, 0x10, 0x10, 0x30, 0x00, 0x00}, /* ) */
+    {0x00, 0x00, 0x10, 0x54, 0x38, 0x38, 0x54, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* * */
+    {0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0xFE, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00}, /* + */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x20, 0x00, 0x00}, /* , */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* - */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x00, 0x00, 0x00}, /* . */
+    {0x00, 0x00, 0x02, 0x04, 0x04, 0x08, 0x08, 0x10, 0x10, 0x20, 0x20, 0x40, 0x00, 0x00}, /* / */
+    {0x00, 0x00, 0x3C, 0x24, 0x42, 0x42, 0x4A, 0x42, 0x42, 0x24, 0x3C, 0x00, 0x00, 0x00}, /* 0 */
+    {0x00, 0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x7C, 0x00, 0x00, 0x00}, /* 1 */
+    {0x00, 0x00, 0x3C, 0x42, 0x02, 0x02, 0x04, 0x08, 0x10, 0x20, 0x7E, 0x00, 0x00, 0x00}, /* 2 */
+    {0x00, 0x00, 0x3C, 0x42, 0x02, 0x02, 0x1C, 0x02, 0x02, 0x42, 0x3C, 0x00, 0x00, 0x00}, /* 3 */
+    {0x00, 0x00, 0x0C, 0x0C, 0x14, 0x34, 0x24, 0x44, 0x7E, 0x04, 0x04, 0x00, 0x00, 0x00}, /* 4 */
+    {0x00, 0x00, 0x7C, 0x40, 0x40, 0x7C, 0x06, 0x02, 0x02, 0x46, 0x3C, 0x00, 0x00, 0x00}, /* 5 */
+    {0x00, 0x00, 0x1C, 0x22, 0x40, 0x5C, 0x66, 0x42, 0x42, 0x26, 0x3C, 0x00, 0x00, 0x00}, /* 6 */
+    {0x00, 0x00, 0x7E, 0x06, 0x04, 0x04, 0x08, 0x08, 0x10, 0x10, 0x20, 0x00, 0x00, 0x00}, /* 7 */
+    {0x00, 0x00, 0x3C, 0x42, 0x42, 0x42, 0x3C, 0x42, 0x42, 0x42, 0x3C, 0x00, 0x00, 0x00}, /* 8 */
+    {0x00, 0x00, 0x3C, 0x64, 0x42, 0x42, 0x46, 0x3A, 0x02, 0x44, 0x38, 0x00, 0x00, 0x00}, /* 9 */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x00, 0x00, 0x10, 0x10, 0x00, 0x00, 0x00}, /* : */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x00, 0x00, 0x10, 0x10, 0x20, 0x00, 0x00}, /* ; */
+    {0x00, 0x00, 0x00, 0x00, 0x02, 0x1C, 0x60, 0x60, 0x1C, 0x02, 0x00, 0x00, 0x00, 0x00}, /* < */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7E, 0x00, 0x7E, 0x00, 0x00, 0x00, 0x00, 0x00}, /* = */
+    {0x00, 0x00, 0x00, 0x00, 0x40, 0x38, 0x06, 0x06, 0x38, 0x40, 0x00, 0x00, 0x00, 0x00}, /* > */
+    {0x00, 0x00, 0x1C, 0x22, 0x02, 0x0C, 0x18, 0x10, 0x00, 0x10, 0x10, 0x00, 0x00, 0x00}, /* ? */
+    {0x00, 0x00, 0x00, 0x1C, 0x26, 0x42, 0x4E, 0x52, 0x52, 0x4E, 0x60, 0x20, 0x1C, 0x00}, /* @ */
+    {0x00, 0x00, 0x18, 0x18, 0x18, 0x24, 0x24, 0x24, 0x3C, 0x42, 0x42, 0x00, 0x00, 0x00}, /* A */
+    {0x00, 0x00, 0x7C, 0x42, 0x42, 0x42, 0x7C, 0x42, 0x42, 0x42, 0x7C, 0x00, 0x00, 0x00}, /* B */
+    {0x00, 0x00, 0x1C, 0x22, 0x40, 0x40, 0x40, 0x40, 0x40, 0x22, 0x1C, 0x00, 0x00, 0x00}, /* C */
+    {0x00, 0x00, 0x78, 0x44, 0x42, 0x42, 0x42, 0x42, 0x42, 0x44, 0x78, 0x00, 0x00, 0x00}, /* D */
+    {0x00, 0x00, 0x7E, 0x40, 0x40, 0x40, 0x7E, 0x40, 0x40, 0x40, 0x7E, 0x00, 0x00, 0x00}, /* E */
+    {0x00, 0x00, 0x7E, 0x40, 0x40, 0x40, 0x7E, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00}, /* F */
+    {0x00, 0x00, 0x1C, 0x22, 0x40, 0x40, 0x46, 0x42, 0x42, 0x22, 0x1C, 0x00, 0x00, 0x00}, /* G */
+    {0x00, 0x00, 0x42, 0x42, 0x42, 0x42, 0x7E, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00}, /* H */
+    {0x00, 0x00, 0x7C, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x7C, 0x00, 0x00, 0x00}, /* I */
+    {0x00, 0x00, 0x1C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x44, 0x38, 0x00, 0x00, 0x00}, /* J */
+    {0x00, 0x00, 0x42, 0x44, 0x48, 0x50, 0x70, 0x48, 0x4C, 0x44, 0x42, 0x00, 0x00, 0x00}, /* K */
+    {0x00, 0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x7E, 0x00, 0x00, 0x00}, /* L */
+    {0x00, 0x00, 0x42, 0x66, 0x66, 0x5A, 0x5A, 0x5A, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00}, /* M */
+    {0x00, 0x00, 0x62, 0x62, 0x52, 0x52, 0x5A, 0x4A, 0x4A, 0x46, 0x46, 0x00, 0x00, 0x00}, /* N */
+    {0x00, 0x00, 0x3C, 0x24, 0x42, 0x42, 0x42, 0x42, 0x42, 0x24, 0x3C, 0x00, 0x00, 0x00}, /* O */
+    {0x00, 0x00, 0x7C, 0x42, 0x42, 0x42, 0x7C, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00}, /* P */
+    {0x00, 0x00, 0x3C, 0x24, 0x42, 0x42, 0x42, 0x42, 0x42, 0x26, 0x3C, 0x04, 0x04, 0x00}, /* Q */
+    {0x00, 0x00, 0x7C, 0x42, 0x42, 0x42, 0x7C, 0x44, 0x42, 0x42, 0x41, 0x00, 0x00, 0x00}, /* R */
+    {0x00, 0x00, 0x3C, 0x42, 0x40, 0x60, 0x3C, 0x02, 0x02, 0x42, 0x3C, 0x00, 0x00, 0x00}, /* S */
+    {0x00, 0x00, 0xFE, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00}, /* T */
+    {0x00, 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x42, 0x3C, 0x00, 0x00, 0x00}, /* U */
+    {0x00, 0x00, 0x42, 0x42, 0x24, 0x24, 0x24, 0x24, 0x18, 0x18, 0x18, 0x00, 0x00, 0x00}, /* V */
+    {0x00, 0x00, 0x82, 0x92, 0x92, 0xAA, 0xAA, 0xAA, 0x6C, 0x44, 0x44, 0x00, 0x00, 0x00}, /* W */
+    {0x00, 0x00, 0x42, 0x24, 0x24, 0x18, 0x18, 0x18, 0x24, 0x24, 0x42, 0x00, 0x00, 0x00}, /* X */
+    {0x00, 0x00, 0x82, 0x44, 0x28, 0x28, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00}, /* Y */
+    {0x00, 0x00, 0x7E, 0x06, 0x04, 0x08, 0x18, 0x10, 0x20, 0x60, 0x7E, 0x00, 0x00, 0x00}, /* Z */
+    {0x00, 0x18, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x18, 0x00, 0x00}, /* [ */
+    {0x00, 0x00, 0x40, 0x20, 0x20, 0x10, 0x10, 0x08, 0x08, 0x04, 0x04, 0x02, 0x00, 0x00}, /*   */
+    {0x00, 0x30, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x30, 0x00, 0x00}, /* ] */
+    {0x00, 0x00, 0x30, 0x48, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* ^ */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFE}, /* _ */
+    {0x00, 0x10, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* ` */
+    {0x00, 0x00, 0x00, 0x00, 0x38, 0x44, 0x04, 0x3C, 0x44, 0x44, 0x3C, 0x00, 0x00, 0x00}, /* a */
+    {0x00, 0x40, 0x40, 0x40, 0x78, 0x44, 0x44, 0x44, 0x44, 0x44, 0x78, 0x00, 0x00, 0x00}, /* b */
+    {0x00, 0x00, 0x00, 0x00, 0x38, 0x64, 0x40, 0x40, 0x40, 0x60, 0x3C, 0x00, 0x00, 0x00}, /* c */
+    {0x00, 0x04, 0x04, 0x04, 0x3C, 0x44, 0x44, 0x44, 0x44, 0x44, 0x3C, 0x00, 0x00, 0x00}, /* d */
+    {0x00, 0x00, 0x00, 0x00, 0x38, 0x64, 0x44, 0x7C, 0x40, 0x44, 0x38, 0x00, 0x00, 0x00}, /* e */
+    {0x00, 0x0C, 0x10, 0x10, 0x7C, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00}, /* f */
+    {0x00, 0x00, 0x00, 0x00, 0x3C, 0x44, 0x44, 0x44, 0x44, 0x44, 0x3C, 0x04, 0x24, 0x18}, /* g */
+    {0x00, 0x40, 0x40, 0x40, 0x58, 0x64, 0x44, 0x44, 0x44, 0x44, 0x44, 0x00, 0x00, 0x00}, /* h */
+    {0x00, 0x10, 0x00, 0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x7C, 0x00, 0x00, 0x00}, /* i */
+    {0x00, 0x08, 0x00, 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x30}, /* j */
+    {0x00, 0x40, 0x40, 0x40, 0x44, 0x48, 0x50, 0x60, 0x50, 0x48, 0x44, 0x00, 0x00, 0x00}, /* k */
+    {0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0C, 0x00, 0x00, 0x00}, /* l */
+    {0x00, 0x00, 0x00, 0x00, 0x7C, 0x54, 0x54, 0x54, 0x54, 0x54, 0x54, 0x00, 0x00, 0x00}, /* m */
+    {0x00, 0x00, 0x00, 0x00, 0x58, 0x64, 0x44, 0x44, 0x44, 0x44, 0x44, 0x00, 0x00, 0x00}, /* n */
+    {0x00, 0x00, 0x00, 0x00, 0x38, 0x44, 0x44, 0x44, 0x44, 0x44, 0x38, 0x00, 0x00, 0x00}, /* o */
+    {0x00, 0x00, 0x00, 0x00, 0x78, 0x44, 0x44, 0x44, 0x44, 0x44, 0x78, 0x40, 0x40, 0x40}, /* p */
+    {0x00, 0x00, 0x00, 0x00, 0x3C, 0x44, 0x44, 0x44, 0x44, 0x44, 0x3C, 0x04, 0x04, 0x04}, /* q */
+    {0x00, 0x00, 0x00, 0x00, 0x3C, 0x32, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00}, /* r */
+    {0x00, 0x00, 0x00, 0x00, 0x38, 0x44, 0x40, 0x38, 0x04, 0x44, 0x38, 0x00, 0x00, 0x00}, /* s */
+    {0x00, 0x00, 0x10, 0x10, 0x7C, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1C, 0x00, 0x00, 0x00}, /* t */
+    {0x00, 0x00, 0x00, 0x00, 0x44, 0x44, 0x44, 0x44, 0x44, 0x44, 0x3C, 0x00, 0x00, 0x00}, /* u */
+    {0x00, 0x00, 0x00, 0x00, 0x44, 0x44, 0x28, 0x28, 0x28, 0x10, 0x10, 0x00, 0x00, 0x00}, /* v */
+    {0x00, 0x00, 0x00, 0x00, 0x82, 0x82, 0x54, 0x54, 0x6C, 0x28, 0x28, 0x00, 0x00, 0x00}, /* w */
+    {0x00, 0x00, 0x00, 0x00, 0x44, 0x28, 0x28, 0x10, 0x28, 0x28, 0x44, 0x00, 0x00, 0x00}, /* x */
+    {0x00, 0x00, 0x00, 0x00, 0x44, 0x44, 0x28, 0x28, 0x28, 0x30, 0x10, 0x10, 0x20, 0x60}, /* y */
+    {0x00, 0x00, 0x00, 0x00, 0x7C, 0x04, 0x08, 0x10, 0x20, 0x40, 0x7C, 0x00, 0x00, 0x00}, /* z */
+    {0x00, 0x1C, 0x10, 0x10, 0x10, 0x10, 0x60, 0x10, 0x10, 0x10, 0x10, 0x1C, 0x00, 0x00}, /* { */
+    {0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00}, /* | */
+    {0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x0C, 0x10, 0x10, 0x10, 0x10, 0x70, 0x00, 0x00}, /* } */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x70, 0x0E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* ~ */
+};
+
+int
+rasterInit(raster *r, int width, int height) {
+    r->width = width;
+    r->height = height;
+    r->pixels = NULL;
+    if (width < 1 || height < 1 || width > RASTER_MAX_SIZE || height > RASTER_MAX_SIZE)
+        return -1;
+    r->pixels = (unsigned int *) malloc(sizeof (unsigned int) * width * height);
+    rasterClip(r, 0, 0, width, height);
+    return r->pixels ? 0 : -1;
+}
+
+void
+rasterFree(raster *r) {
+    free(r->pixels);
+    r->pixels = NULL;
+}
+
+void
+rasterClip(raster *r, int x, int y, int width, int height) {
+    r->clipX0 = x < 0 ? 0 : x;
+    r->clipY0 = y < 0 ? 0 : y;
+    r->clipX1 = x + width > r->width ? r->width : x + width;
+    r->clipY1 = y + height > r->height ? r->height : y + height;
+}
+
+unsigned int
+rasterColour(const char *colour) {
+    unsigned int rgb;
+    if (colour[0] != '#' || strlen(colour) != 7 || sscanf(colour + 1, "%x", &rgb) != 1)
+        return 0;
+    return rgb;
+}
+
+void
+rasterClear(raster *r, unsigned int colour) {
+    size_t i, n = (size_t) r->width * r->height;
+    for (i = 0; i < n; i++)
+        r->pixels[i] = colour;
+}
+
+void
+rasterCopy(raster *dst, const raster *src) {
+    memcpy(dst->pixels, src->pixels, sizeof (unsigned int) * src->width * src->height);
+}
+
+void
+rasterCopyRectangle(raster *dst, const raster *src, int x, int y, int width, int height) {
+    int i;
+    if (x < 0) {
+        width += x;
+        x = 0;
+    }
+    if (y < 0) {
+        height += y;
+        y = 0;
+    }
+    width = x + width > src->width ? src->width - x : width;
+    height = y + height > src->height ? src->height - y : height;
+    for (i = 0; i < height && width > 0; i++)
+        memcpy(dst->pixels + (size_t) (y + i) * dst->width + x, src->pixels + (size_t) (y + i) * src->width + x,
+                sizeof (unsigned int) * width);
+}
+
+void
+rasterPoint(raster *r, int x, int y, unsigned int colour) {
+    if (x >= r->clipX0 && x < r->clipX1 && y >= r->clipY0 && y < r->clipY1)
+        r->pixels[(size_t) y * r->width + x] = colour;
+}
+
+/* Bresenham, skipping pixels outside the clip. */
+void
+rasterLine(raster *r, int x0, int y0, int x1, int y1, unsigned int colour) {
+    int dx = abs(x1 - x0), dy = -abs(y1 - y0), sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1, err = dx + dy, e2;
+    while (1) {
+        rasterPoint(r, x0, y0, colour);
+        if (x0 == x1 && y0 == y1)
+            break;
+        e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+static void
+span(raster *r, int y, int x0, int x1, unsigned int colour) {
+    unsigned int *p;
+    if (y < r->clipY0 || y >= r->clipY1)
+        return;
+    x0 = x0 < r->clipX0 ? r->clipX0 : x0;
+    x1 = x1 >= r->clipX1 ? r->clipX1 - 1 : x1;
+    for (p = r->pixels + (size_t) y * r->width + x0; x0 <= x1; x0++)
+        *p++ = colour;
+}
+
+void
+rasterFillRectangle(raster *r, int x, int y, int width, int height, unsigned int colour) {
+    int i;
+    for (i = 0; i < height; i++)
+        span(r, y + i, x, x + width - 1, colour);
+}
+
+void
+rasterRectangle(raster *r, int x, int y, int width, int height, int lineWidth, unsigned int colour) {
+    int inset = lineWidth / 2;
+    x -= inset;
+    y -= inset;
+    width += lineWidth;
+    height += lineWidth;
+    rasterFillRectangle(r, x, y, width, lineWidth, colour);
+    rasterFillRectangle(r, x, y + height - lineWidth, width, lineWidth, colour);
+    rasterFillRectangle(r, x, y, lineWidth, height, colour);
+    rasterFillRectangle(r, x + width - lineWidth, y, lineWidth, height, colour);
+}
+
+void
+rasterFillCircle(raster *r, double cx, double cy, double radius, unsigned int colour) {
+    int y, last = (int) floor(cy + radius - 0.5);
+    double dy, dx;
+    for (y = (int) ceil(cy - radius - 0.5); y <= last; y++) {
+        dy = y + 0.5 - cy;
+        dx = radius * radius - dy * dy;
+        if (dx < 0)
+            continue;
+        dx = sqrt(dx);
+        span(r, y, (int) ceil(cx - dx - 0.5), (int) floor(cx + dx - 0.5), colour);
+    }
+}
+
+/*
+ * Walks the ellipse once along x and once along y so that neither its flat
+ * nor its steep parts leave gaps.
+ */
+void
+rasterEllipse(raster *r, double cx, double cy, double a, double b, unsigned int colour) {
+    int i, x, y;
+    double t;
+    if (!(a > 0 && b > 0)) {
+        /* flattened all the way to a line, or a point */
+        a = a > 0 ? a : 0;
+        b = b > 0 ? b : 0;
+        rasterLine(r, (int) lround(cx - a), (int) lround(cy - b), (int) lround(cx + a), (int) lround(cy + b), colour);
+        return;
+    }
+    for (i = 0; i <= a; i++) {
+        t = i / a;
+        y = (int) lround(b * sqrt(1 - t * t));
+        rasterPoint(r, (int) lround(cx + i), (int) lround(cy + y), colour);
+        rasterPoint(r, (int) lround(cx + i), (int) lround(cy - y), colour);
+        rasterPoint(r, (int) lround(cx - i), (int) lround(cy + y), colour);
+        rasterPoint(r, (int) lround(cx - i), (int) lround(cy - y), colour);
+    }
+    for (i = 0; i <= b; i++) {
+        t = i / b;
+        x = (int) lround(a * sqrt(1 - t * t));
+        rasterPoint(r, (int) lround(cx + x), (int) lround(cy + i), colour);
+        rasterPoint(r, (int) lround(cx + x), (int) lround(cy - i), colour);
+        rasterPoint(r, (int) lround(cx - x), (int) lround(cy + i), colour);
+        rasterPoint(r, (int) lround(cx - x), (int) lround(cy - i), colour);
+    }
+}
+
+int
+rasterTextWidth(const char *str) {
+    return strlen(str) * RASTER_FONT_WIDTH;
+}
+
+void
+rasterText(raster *r, int x, int y, const char *str, unsigned int colour) {
+    const unsigned char *glyph;
+    int row, column;
+    for (y -= RASTER_FONT_ASCENT; *str; str++, x += RASTER_FONT_WIDTH) {
+        if (*str < ' ' || *str > '~')
+            continue;
+        glyph = font[*str - ' '];
+        for (row = 0; row < RASTER_FONT_HEIGHT; row++)
+            for (column = 0; column < RASTER_FONT_WIDTH; column++)
+                if (glyph[row] & (0x80 >> column))
+                    rasterPoint(r, x + column, y + row, colour);
+    }
+}
+
+int
+rasterWriteRGB(const raster *r, FILE *out) {
+    unsigned char *row = (unsigned char *) malloc(3 * r->width);
+    const unsigned int *p = r->pixels;
+    int x, y, status = 0;
+
+    if (!row)
+        return -1;
+    for (y = 0; y < r->height && !status; y++) {
+        for (x = 0; x < r->width; x++, p++) {
+            row[3 * x] = *p >> 16;
+            row[3 * x + 1] = *p >> 8;
+            row[3 * x + 2] = *p;
+        }
+        if (fwrite(row, 3, r->width, out) != (size_t) r->width)
+            status = -1;
+    }
+    free(row);
+    return status;
+}
+
+int
+rasterWritePPM(const raster *r, FILE *out) {
+    if (fprintf(out, "P6\n%d %d\n255\n", r->width, r->height) < 0)
+        return -1;
+    return rasterWriteRGB(r, out);
+}
@@ -0,0 +1,80 @@
+/*
+ * File:   raster.h
+ * Author: dibyendu
+ *
+ * A small software rasterizer for drawing without an X server. Frames are
+ * arrays of 0x00RRGGBB pixels, row after row; everything drawn is clipped
+ * to the clip rectangle, which is the whole frame unless narrowed.
+ */
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    int width, height;
+    unsigned int *pixels;
+    int clipX0, clipY0, clipX1, clipY1;
+} raster;
+
+/* The built in font: fixed cells, with the baseline RASTER_FONT_ASCENT rows down. */
+#define RASTER_FONT_WIDTH 8
+#define RASTER_FONT_HEIGHT 14
+#define RASTER_FONT_ASCENT 11
+
+/* Largest width or height of a frame. */
+#define RASTER_MAX_SIZE 16384
+
+/* Returns -1 if out of memory or either side is not within 1 to RASTER_MAX_SIZE. */
+int rasterInit(raster *r, int width, int height);
+void rasterFree(raster *r);
+
+/* Restricts drawing to a rectangle of the frame. */
+void rasterClip(raster *r, int x, int y, int width, int height);
+
+/* Parses "#RRGGBB"; anything else is black. */
+unsigned int rasterColour(const char *colour);
+
+void rasterClear(raster *r, unsigned int colour);
+
+/* Copies a frame of the same size. */
+void rasterCopy(raster *dst, const raster *src);
+
+/* Copies a rectangle between frames of the same size, ignoring the clip. */
+void rasterCopyRectangle(raster *dst, const raster *src, int x, int y, int width, int height);
+
+void rasterPoint(raster *r, int x, int y, unsigned int colour);
+void rasterLine(raster *r, int x0, int y0, int x1, int y1, unsigned int colour);
+void rasterFillRectangle(raster *r, int x, int y, int width, int height, unsigned int colour);
+
+/* Outline centred on the edges of the rectangle, as XDrawRectangle does. */
+void rasterRectangle(raster *r, int x, int y, int width, int height, int lineWidth, unsigned int colour);
+
+/* Fills the pixels whose centres lie inside the circle. */
+void rasterFillCircle(raster *r, double cx, double cy, double radius, unsigned int colour);
+
+/*
+ * One pixel wide outline of the axis aligned ellipse with semi axes a, b;
+ * a line if either is 0.
+ */
+void rasterEllipse(raster *r, double cx, double cy, double a, double b, unsigned int colour);
+
+int rasterTextWidth(const char *str);
+
+/* Draws printable ASCII with its baseline at y, like XDrawString. */
+void rasterText(raster *r, int x, int y, const char *str, unsigned int colour);
+
+/* Writes the frame as a binary PPM, or as bare RGB bytes. Return -1 on error. */
+int rasterWritePPM(const raster *r, FILE *out);
+int rasterWriteRGB(const raster *r, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
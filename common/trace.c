@@ -0,0 +1,206 @@
+/*
+ * File:   trace.c
+ * Author: dibyendu
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "trace.h"
+
+double
+traceNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+void
+traceInit(tracer *t) {
+    memset(t, 0, sizeof (tracer));
+    t->origin = traceNow();
+    pthread_mutex_init(&t->lock, NULL);
+}
+
+void
+traceFree(tracer *t) {
+    free(t->spans);
+    t->spans = NULL;
+    t->count = t->capacity = 0;
+    pthread_mutex_destroy(&t->lock);
+}
+
+void
+traceRecord(tracer *t, const char *name, int thread, double start, double end, long requests) {
+    traceSpan *s;
+
+    if (!t)
+        return;
+    pthread_mutex_lock(&t->lock);
+    if (t->count == t->capacity && t->capacity < TRACE_MAX_SPANS) {
+        int capacity = t->capacity ? t->capacity * 2 : 4096;
+        s = (traceSpan *) realloc(t->spans, sizeof (traceSpan) * capacity);
+        if (s) {
+            t->spans = s;
+            t->capacity = capacity;
+        }
+    }
+    if (t->count < t->capacity) {
+        s = t->spans + t->count++;
+        s->name = name;
+        s->thread = thread;
+        s->start = start - t->origin;
+        s->duration = end - start;
+        s->requests = requests;
+    } else
+        t->dropped++;
+    pthread_mutex_unlock(&t->lock);
+}
+
+static int
+compareDouble(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return x < y ? -1 : x > y;
+}
+
+/* Durations of the spans called name, sorted; returns how many. */
+static int
+durations(const tracer *t, const char *name, double *d) {
+    int i, n = 0;
+    for (i = 0; i < t->count; i++)
+        if (!strcmp(t->spans[i].name, name))
+            d[n++] = t->spans[i].duration;
+    qsort(d, n, sizeof (double), compareDouble);
+    return n;
+}
+
+/* Nearest rank percentile of n sorted values. */
+static double
+percentile(const double *d, int n, double p) {
+    int k = (int) ceil(p / 100 * n) - 1;
+    return d[k < 0 ? 0 : k >= n ? n - 1 : k];
+}
+
+void
+traceSummary(tracer *t, FILE *out) {
+    const char **names;
+    double *d, total;
+    long requests, maxRequests;
+    int i, j, n, noOfNames = 0, recorded = 0;
+
+    if (!t)
+        return;
+    pthread_mutex_lock(&t->lock);
+    d = (double *) malloc(sizeof (double) * (t->count + 1));
+    names = (const char **) malloc(sizeof (char *) * (t->count + 1));
+    for (i = 0; names && i < t->count; i++) {
+        for (j = noOfNames - 1; j >= 0 && strcmp(names[j], t->spans[i].name); j--)
+            ;
+        if (j < 0)
+            names[noOfNames++] = t->spans[i].name;
+        recorded |= t->spans[i].requests >= 0;
+    }
+    fprintf(out, "%-24s %8s %10s %10s %10s %10s %10s %10s %10s%s\n", "span", "count", "total s", "per s",
+            "mean us", "p50 us", "p90 us", "p99 us", "max us", recorded ? "  X requests" : "");
+    for (i = 0; d && names && i < noOfNames; i++) {
+        n = durations(t, names[i], d);
+        for (j = 0, total = 0; j < n; j++)
+            total += d[j];
+        for (j = 0, requests = maxRequests = 0, recorded = 0; j < t->count; j++)
+            if (t->spans[j].requests >= 0 && !strcmp(t->spans[j].name, names[i])) {
+                requests += t->spans[j].requests;
+                maxRequests = t->spans[j].requests > maxRequests ? t->spans[j].requests : maxRequests;
+                recorded++;
+            }
+        fprintf(out, "%-24s %8d %10.3f %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f", names[i], n, total,
+                total > 0 ? n / total : 0, total / n * 1e6, percentile(d, n, 50) * 1e6, percentile(d, n, 90) * 1e6,
+                percentile(d, n, 99) * 1e6, d[n - 1] * 1e6);
+        /* mean and maximum per span */
+        if (recorded)
+            fprintf(out, " %7.1f/%-6ld\n", (double) requests / recorded, maxRequests);
+        else
+            fputc('\n', out);
+    }
+    if (t->dropped)
+        fprintf(out, "%d spans dropped\n", t->dropped);
+    pthread_mutex_unlock(&t->lock);
+    free(names);
+    free(d);
+}
+
+void
+traceHistogram(tracer *t, const char *name, FILE *out) {
+    int buckets[64] = {0}, i, n, low = 63, high = 0, most = 0, k;
+    double *d;
+
+    if (!t)
+        return;
+    pthread_mutex_lock(&t->lock);
+    d = (double *) malloc(sizeof (double) * (t->count + 1));
+    n = d ? durations(t, name, d) : 0;
+    /* bucket k holds durations of [2^k, 2^(k+1)) microseconds */
+    for (i = 0; i < n; i++) {
+        k = d[i] * 1e6 < 1 ? 0 : (int) log2(d[i] * 1e6);
+        k = k > 63 ? 63 : k;
+        buckets[k]++;
+        low = k < low ? k : low;
+        high = k > high ? k : high;
+        most = buckets[k] > most ? buckets[k] : most;
+    }
+    fprintf(out, "%s: %d spans\n", name, n);
+    for (k = low; n && k <= high; k++) {
+        fprintf(out, "%10.0f - %-10.0f us %8d ", ldexp(1, k), ldexp(1, k + 1), buckets[k]);
+        for (i = 0; i < (buckets[k] * 50 + most - 1) / most; i++)
+            fputc('#', out);
+        fputc('\n', out);
+    }
+    pthread_mutex_unlock(&t->lock);
+    free(d);
+}
+
+int
+traceWriteChrome(tracer *t, FILE *out) {
+    const traceSpan *s;
+    int i;
+
+    if (!t)
+        return 0;
+    pthread_mutex_lock(&t->lock);
+    fputs("{\"traceEvents\":[\n", out);
+    for (i = 0; i < t->count; i++) {
+        s = t->spans + i;
+        fprintf(out, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f", s->name, s->thread,
+                s->start * 1e6, s->duration * 1e6);
+        if (s->requests >= 0)
+            fprintf(out, ",\"args\":{\"requests\":%ld}", s->requests);
+        fputs(i + 1 < t->count ? "},\n" : "}\n", out);
+    }
+    fputs("],\"displayTimeUnit\":\"ms\"}\n", out);
+    pthread_mutex_unlock(&t->lock);
+    return ferror(out) ? -1 : 0;
+}
+
+int
+traceReport(tracer *t, const char *path, FILE *stats, const char *histogram) {
+    FILE *out;
+    int status = 0;
+
+    if (!t)
+        return 0;
+    if (path) {
+        if (!(out = fopen(path, "w")) || traceWriteChrome(t, out) < 0) {
+            perror(path);
+            status = -1;
+        }
+        if (out && fclose(out) && !status) {
+            perror(path);
+            status = -1;
+        }
+    }
+    if (stats) {
+        traceSummary(t, stats);
+        traceHistogram(t, histogram, stats);
+    }
+    return status;
+}
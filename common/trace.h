@@ -0,0 +1,79 @@
+/*
+ * File:   trace.h
+ * Author: dibyendu
+ *
+ * Opt-in instrumentation: timed spans (a frame, a physics step, a curve
+ * evaluation) with the number of X requests each one issued, kept in
+ * memory and reported at exit as a table of latency percentiles, a
+ * histogram, or a Chrome trace file (chrome://tracing, Perfetto). Passing
+ * a NULL tracer makes every call a no-op, so instrumented code pays for
+ * nothing but the clock reads when tracing is off.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *name;
+    double start, duration;
+    long requests;
+    int thread;
+} traceSpan;
+
+/* Spans past TRACE_MAX_SPANS are counted as dropped instead of kept. */
+#define TRACE_MAX_SPANS (1 << 22)
+
+typedef struct {
+    double origin;
+    traceSpan *spans;
+    int count, capacity, dropped;
+    pthread_mutex_t lock;
+} tracer;
+
+/* Seconds on the monotonic clock. */
+double traceNow(void);
+
+void traceInit(tracer *t);
+void traceFree(tracer *t);
+
+/*
+ * Records a span from start to end (traceNow() times) on the given thread,
+ * which is just a number to tell threads apart in the trace. name must
+ * outlive the tracer; requests is -1 where nothing talks to the server.
+ * Safe to call from several threads.
+ */
+void traceRecord(tracer *t, const char *name, int thread, double start, double end, long requests);
+
+/*
+ * One line per span name, in order of first appearance: count, total time,
+ * rate, mean and percentiles of the duration, and mean and maximum X
+ * requests when recorded.
+ */
+void traceSummary(tracer *t, FILE *out);
+
+/* Durations of the spans called name in power of two buckets. */
+void traceHistogram(tracer *t, const char *name, FILE *out);
+
+/* Returns -1 on a write error. */
+int traceWriteChrome(tracer *t, FILE *out);
+
+/*
+ * The report the applications give at exit: the Chrome trace written to
+ * path unless it is NULL, then the summary and the histogram of the spans
+ * called histogram printed to stats unless that is NULL. Returns -1 if the
+ * trace could not be written.
+ */
+int traceReport(tracer *t, const char *path, FILE *stats, const char *histogram);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ * File:   xcache.c
+ * Author: dibyendu
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include "xcache.h"
+
+xcache *
+xcacheOpen(Display *d, int screen, Drawable drawable) {
+    xcache *c = (xcache *) calloc(1, sizeof (xcache));
+    if (!c)
+        return NULL;
+    c->d = d;
+    c->screen = screen;
+    c->drawable = drawable;
+    return c;
+}
+
+void
+xcacheClose(xcache *c) {
+    int i;
+    if (!c)
+        return;
+    if (c->font)
+        XFreeFont(c->d, c->font);
+    for (i = 0; i < c->noOfColours; i++) {
+        if (c->colours[i].allocated)
+            XFreeColors(c->d, DefaultColormap(c->d, c->screen), &c->colours[i].color.pixel, 1, 0);
+        free(c->colours[i].name);
+    }
+    for (i = 0; i < c->noOfGcs; i++) {
+        XFreeGC(c->d, c->gcs[i].gc);
+        free(c->gcs[i].colour);
+    }
+    for (i = 0; i < c->noOfTexts; i++)
+        free(c->texts[i].str);
+    free(c->colours);
+    free(c->gcs);
+    free(c->texts);
+    free(c);
+}
+
+XFontStruct *
+xcacheFont(xcache *c) {
+    char **list;
+    int returnNo;
+
+    if (c->font)
+        return c->font;
+    list = XListFonts(c->d, "-*-*-bold-r-normal--*-*-100-100-c-*-*", 200, &returnNo);
+    if (list) {
+        srand(time(NULL));
+        c->font = XLoadQueryFont(c->d, list[rand() % returnNo]);
+        XFreeFontNames(list);
+    }
+    if (!c->font)
+        c->font = XLoadQueryFont(c->d, "fixed");
+    return c->font;
+}
+
+unsigned long
+xcachePixel(xcache *c, const char *colour) {
+    xcacheColour *colours;
+    XColor xcolor;
+    Bool allocated;
+    char *name;
+    int i;
+
+    for (i = 0; i < c->noOfColours; i++)
+        if (!strcmp(c->colours[i].name, colour))
+            return c->colours[i].color.pixel;
+
+    allocated = XParseColor(c->d, DefaultColormap(c->d, c->screen), colour, &xcolor)
+            && XAllocColor(c->d, DefaultColormap(c->d, c->screen), &xcolor);
+    if (!allocated)
+        xcolor.pixel = BlackPixel(c->d, c->screen);
+    colours = (xcacheColour *) realloc(c->colours, sizeof (xcacheColour) * (c->noOfColours + 1));
+    if (!colours)
+        return xcolor.pixel;
+    c->colours = colours;
+    if (!(name = strdup(colour)))
+        return xcolor.pixel;
+    c->colours[c->noOfColours].name = name;
+    c->colours[c->noOfColours].color = xcolor;
+    c->colours[c->noOfColours].allocated = allocated;
+    c->noOfColours++;
+    return xcolor.pixel;
+}
+
+GC
+xcacheGC(xcache *c, const char *colour, int lineWidth) {
+    xcacheGc *gcs;
+    GC gc;
+    char *name;
+    int i;
+
+    for (i = 0; i < c->noOfGcs; i++)
+        if (c->gcs[i].lineWidth == lineWidth && !strcmp(c->gcs[i].colour, colour))
+            return c->gcs[i].gc;
+
+    gc = XCreateGC(c->d, c->drawable, 0, 0);
+    XSetForeground(c->d, gc, xcachePixel(c, colour));
+    XSetLineAttributes(c->d, gc, lineWidth, LineSolid, CapRound, JoinRound);
+    XSetFillStyle(c->d, gc, FillSolid);
+    gcs = (xcacheGc *) realloc(c->gcs, sizeof (xcacheGc) * (c->noOfGcs + 1));
+    if (!gcs)
+        return gc;
+    c->gcs = gcs;
+    if (!(name = strdup(colour)))
+        return gc;
+    c->gcs[c->noOfGcs].colour = name;
+    c->gcs[c->noOfGcs].lineWidth = lineWidth;
+    c->gcs[c->noOfGcs].gc = gc;
+    c->noOfGcs++;
+    return gc;
+}
+
+int
+xcacheTextWidth(xcache *c, const char *str) {
+    XFontStruct *font = xcacheFont(c);
+    int i, width;
+
+    if (!font)
+        return 0;
+    for (i = 0; i < c->noOfTexts; i++)
+        if (!strcmp(c->texts[i].str, str))
+            return c->texts[i].width;
+
+    width = XTextWidth(font, str, strlen(str));
+    if (c->noOfTexts < XCACHE_MAX_TEXTS) {
+        if (!c->texts)
+            c->texts = (xcacheText *) malloc(sizeof (xcacheText) * XCACHE_MAX_TEXTS);
+        if (c->texts && (c->texts[c->noOfTexts].str = strdup(str))) {
+            c->texts[c->noOfTexts].width = width;
+            c->noOfTexts++;
+        }
+    }
+    return width;
+}
+
+int
+xcacheTextHeight(xcache *c) {
+    XFontStruct *font = xcacheFont(c);
+    return font ? font->ascent + font->descent : 0;
+}
+
+double
+xcacheScale(Display *d, int screen) {
+    const char *resource = XGetDefault(d, "Xft", "dpi");
+    double dpi = 96, scale;
+
+    if (resource && atof(resource) > 0)
+        dpi = atof(resource);
+    else if (DisplayWidthMM(d, screen) > 0)
+        dpi = DisplayWidth(d, screen) * 25.4 / DisplayWidthMM(d, screen);
+    scale = floor(dpi / 96 * 4 + 0.5) / 4;
+    return scale < 1 ? 1 : scale;
+}
@@ -0,0 +1,83 @@
+/*
+ * File:   xcache.h
+ * Author: dibyendu
+ *
+ * X resources shared by the applications: the text font, allocated colour
+ * pixels and GCs are each looked up on the server once and then reused, so
+ * long sessions over a remote display neither stall on round trips nor grow
+ * the server's memory.
+ */
+
+#ifndef XCACHE_H
+#define XCACHE_H
+
+#include <X11/Xlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Colours the server could not allocate are kept too, as black, so they are not asked for again. */
+typedef struct {
+    char *name;
+    XColor color;
+    Bool allocated;
+} xcacheColour;
+
+typedef struct {
+    char *colour;
+    int lineWidth;
+    GC gc;
+} xcacheGc;
+
+typedef struct {
+    char *str;
+    int width;
+} xcacheText;
+
+typedef struct {
+    Display *d;
+    int screen;
+    Drawable drawable;
+    XFontStruct *font;
+    xcacheColour *colours;
+    xcacheGc *gcs;
+    xcacheText *texts;
+    int noOfColours, noOfGcs, noOfTexts;
+} xcache;
+
+#define XCACHE_MAX_TEXTS 256
+
+xcache *xcacheOpen(Display *d, int screen, Drawable drawable);
+
+/* Frees every cached resource; the display itself stays open. */
+void xcacheClose(xcache *c);
+
+/*
+ * The bold text font, picked at random among the matching ones on first
+ * use as the applications always did, falling back to "fixed".
+ */
+XFontStruct *xcacheFont(xcache *c);
+
+unsigned long xcachePixel(xcache *c, const char *colour);
+
+/* A solid GC with round caps and joins, shared by all callers asking for it. */
+GC xcacheGC(xcache *c, const char *colour, int lineWidth);
+
+/* Width of str in the cache font, remembered for the first few hundred strings. */
+int xcacheTextWidth(xcache *c, const char *str);
+int xcacheTextHeight(xcache *c);
+
+/*
+ * How many pixels of the screen stand for one pixel of a 96 DPI display:
+ * from the Xft.dpi resource when the desktop sets one, else from the
+ * physical size the server reports, in quarter steps and never below 1.
+ * Needs no cache, so that windows can be sized with it.
+ */
+double xcacheScale(Display *d, int screen);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
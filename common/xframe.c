@@ -0,0 +1,142 @@
+/*
+ * File:   xframe.c
+ * Author: dibyendu
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "xframe.h"
+
+static bool attachFailed;
+
+static int
+catchAttach(Display *d, XErrorEvent *e) {
+    (void) d;
+    (void) e;
+    attachFailed = true;
+    return 0;
+}
+
+/*
+ * XShmAttach is only refused once the server processes it, typically with
+ * BadAccess when the server runs on another machine, so wait for it with
+ * the error caught instead of letting the default handler exit.
+ */
+static bool
+attachShared(xframe *f, int screen, int width, int height) {
+    int (*handler)(Display *, XErrorEvent *);
+
+    if (!XShmQueryExtension(f->d))
+        return false;
+    f->image = XShmCreateImage(f->d, DefaultVisual(f->d, screen), DefaultDepth(f->d, screen), ZPixmap, NULL, &f->shm, width, height);
+    if (!f->image)
+        return false;
+    f->shm.shmid = shmget(IPC_PRIVATE, f->image->bytes_per_line * height, IPC_CREAT | 0600);
+    if (f->shm.shmid < 0) {
+        XDestroyImage(f->image);
+        return false;
+    }
+    f->shm.shmaddr = (char *) shmat(f->shm.shmid, NULL, 0);
+    f->shm.readOnly = False;
+    if (f->shm.shmaddr == (char *) -1) {
+        shmctl(f->shm.shmid, IPC_RMID, NULL);
+        XDestroyImage(f->image);
+        return false;
+    }
+    f->image->data = f->shm.shmaddr;
+    XSync(f->d, False);
+    attachFailed = false;
+    handler = XSetErrorHandler(catchAttach);
+    XShmAttach(f->d, &f->shm);
+    XSync(f->d, False);
+    XSetErrorHandler(handler);
+    /* the segment goes away with the last detach, even if we crash */
+    shmctl(f->shm.shmid, IPC_RMID, NULL);
+    if (attachFailed) {
+        shmdt(f->shm.shmaddr);
+        f->image->data = NULL;
+        XDestroyImage(f->image);
+        return false;
+    }
+    return true;
+}
+
+static int
+hostByteOrder(void) {
+    int one = 1;
+    return *(unsigned char *) &one ? LSBFirst : MSBFirst;
+}
+
+int
+xframeInit(xframe *f, Display *d, int screen, int width, int height) {
+    Visual *visual = DefaultVisual(d, screen);
+    char *data;
+
+    memset(f, 0, sizeof (xframe));
+    f->d = d;
+    if (visual->class != TrueColor || visual->red_mask != 0xFF0000 || visual->green_mask != 0xFF00 || visual->blue_mask != 0xFF)
+        return -1;
+    f->shared = attachShared(f, screen, width, height);
+    if (!f->shared) {
+        data = (char *) malloc(sizeof (unsigned int) * width * height);
+        if (!data)
+            return -1;
+        f->image = XCreateImage(d, visual, DefaultDepth(d, screen), ZPixmap, 0, data, width, height, 32, 0);
+        if (!f->image) {
+            free(data);
+            return -1;
+        }
+        /* Xlib swaps the bytes on the way out if the server wants them otherwise */
+        f->image->byte_order = hostByteOrder();
+    }
+    /* the raster writes whole native words, row after row */
+    if (f->image->bits_per_pixel != 32 || f->image->bytes_per_line != width * 4 || f->image->byte_order != hostByteOrder()) {
+        xframeFree(f);
+        return -1;
+    }
+    f->r.width = width;
+    f->r.height = height;
+    f->r.pixels = (unsigned int *) f->image->data;
+    rasterClip(&f->r, 0, 0, width, height);
+    return 0;
+}
+
+void
+xframeFree(xframe *f) {
+    if (!f->image)
+        return;
+    if (f->shared) {
+        XShmDetach(f->d, &f->shm);
+        XSync(f->d, False);
+        shmdt(f->shm.shmaddr);
+        f->image->data = NULL;
+    }
+    /* frees the malloc'd data of an unshared image too */
+    XDestroyImage(f->image);
+    f->image = NULL;
+    f->r.pixels = NULL;
+}
+
+void
+xframePut(xframe *f, Drawable dst, GC gc, int x, int y, int width, int height) {
+    /* the server refuses rectangles that reach outside the image */
+    if (x < 0) {
+        width += x;
+        x = 0;
+    }
+    if (y < 0) {
+        height += y;
+        y = 0;
+    }
+    width = x + width > f->r.width ? f->r.width - x : width;
+    height = y + height > f->r.height ? f->r.height - y : height;
+    if (width <= 0 || height <= 0)
+        return;
+    if (f->shared) {
+        XShmPutImage(f->d, dst, gc, f->image, x, y, x, y, width, height, False);
+        XSync(f->d, False);
+    } else
+        XPutImage(f->d, dst, gc, f->image, x, y, x, y, width, height);
+}
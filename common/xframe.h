@@ -0,0 +1,51 @@
+/*
+ * File:   xframe.h
+ * Author: dibyendu
+ *
+ * A raster whose pixels are the data of an XImage, so a whole software
+ * rendered frame reaches the window in a single request. When the server
+ * is local and has the MIT-SHM extension the image lives in shared memory
+ * and is presented with XShmPutImage without going through the socket;
+ * otherwise (remote displays, no extension) it is sent with XPutImage.
+ */
+
+#ifndef XFRAME_H
+#define XFRAME_H
+
+#include <stdbool.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include "raster.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    Display *d;
+    XImage *image;
+    XShmSegmentInfo shm;
+    bool shared;
+    raster r;
+} xframe;
+
+/*
+ * Returns -1 if the default visual does not take 0x00RRGGBB pixels as they
+ * are, or if out of memory; the caller then has to draw with Xlib.
+ */
+int xframeInit(xframe *f, Display *d, int screen, int width, int height);
+void xframeFree(xframe *f);
+
+/*
+ * Copies a rectangle of the frame, clipped to it, to the same place in
+ * dst. Waits for the server to be done with a shared image, so the frame
+ * may be drawn into again as soon as this returns.
+ */
+void xframePut(xframe *f, Drawable dst, GC gc, int x, int y, int width, int height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif